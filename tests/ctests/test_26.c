@@ -0,0 +1,76 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_26
+// Summary: USERFAULT: child faults on a MAP_USERFAULT map, parent fills the page
+// ====================================================================
+
+char *test_name = "TEST_26";
+
+char page[PGSIZE];
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    uint uaddr = MMAPBASE;
+    uint raddr = MMAPBASE + PGSIZE;
+    int anon = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS;
+
+    // userfault map, and a shared page for the child's result
+    if (wmap(uaddr, PGSIZE, anon | MAP_USERFAULT, -1) != uaddr ||
+        wmap(raddr, PGSIZE, anon, -1) != raddr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    int *result = (int *)raddr;
+    *result = 0; // load the page before fork so it stays shared
+
+    int pid = fork();
+    if (pid < 0) {
+        printerr("fork() failed\n");
+        failed();
+    } else if (pid == 0) {
+        char *arr = (char *)uaddr;
+        int ok = 1;
+        for (int i = 0; i < PGSIZE; i++) {
+            if (arr[i] != (char)(i % 251)) {
+                ok = 0;
+                break;
+            }
+        }
+        *result = ok ? 1 : -1;
+        exit();
+    }
+
+    struct wfaultinfo info;
+    if (wfault(&info) < 0) {
+        printerr("wfault() failed\n");
+        failed();
+    }
+    if (info.pid != pid || info.addr != uaddr) {
+        printerr("wfault() reported pid %d addr 0x%x, expected pid %d addr 0x%x\n",
+                 info.pid, info.addr, pid, uaddr);
+        failed();
+    }
+    for (int i = 0; i < PGSIZE; i++)
+        page[i] = i % 251;
+    if (wfill(pid, uaddr + PGSIZE, page) != FAILED || wfill(pid + 1, uaddr, page) != FAILED) {
+        printerr("wfill() of a fault nobody reported succeeded\n");
+        failed();
+    }
+    if (wfill(pid, uaddr, page) < 0) {
+        printerr("wfill() failed\n");
+        failed();
+    }
+    wait();
+    if (wfill(pid, uaddr, page) != FAILED) {
+        printerr("wfill() with no fault waiting succeeded\n");
+        failed();
+    }
+
+    if (*result != 1) {
+        printerr("child saw the wrong page contents (%d)\n", *result);
+        failed();
+    }
+    success();
+}
@@ -0,0 +1,67 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_27
+// Summary: WPROTECT: read-only middle page splits the map, RW again joins it
+// ====================================================================
+
+char *test_name = "TEST_27";
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    uint addr = MMAPBASE;
+    int length = 4 * PGSIZE;
+    int anon = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS;
+    struct wmapinfo info;
+
+    if (wmap(addr, length, anon, -1) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    char *arr = (char *)addr;
+    arr[0] = 'a';
+    arr[PGSIZE] = 'b';
+
+    // pages 1 and 2 read-only; page 2 is not loaded yet
+    if (wprotect(addr + PGSIZE, 2 * PGSIZE, PROT_READ) != SUCCESS) {
+        printerr("wprotect(PROT_READ) failed\n");
+        failed();
+    }
+    get_n_validate_wmap_info(&info, 3);
+    map_exists(&info, addr, PGSIZE, TRUE);
+    map_exists(&info, addr + PGSIZE, 2 * PGSIZE, TRUE);
+    map_exists(&info, addr + 3 * PGSIZE, PGSIZE, TRUE);
+    if (arr[PGSIZE] != 'b' || arr[2 * PGSIZE] != 0) {
+        printerr("read-only pages have the wrong contents\n");
+        failed();
+    }
+    va_exists(addr + 2 * PGSIZE, TRUE);
+
+    // outside any map
+    if (wprotect(addr + 3 * PGSIZE, 2 * PGSIZE, PROT_READ) != FAILED) {
+        printerr("wprotect() of an unmapped range succeeded\n");
+        failed();
+    }
+
+    if (wprotect(addr + PGSIZE, 2 * PGSIZE, PROT_READ | PROT_WRITE) != SUCCESS) {
+        printerr("wprotect(PROT_READ | PROT_WRITE) failed\n");
+        failed();
+    }
+    get_n_validate_wmap_info(&info, 1);
+    map_exists(&info, addr, length, TRUE);
+    arr[PGSIZE] = 'c';
+    arr[2 * PGSIZE] = 'd';
+    if (arr[0] != 'a' || arr[PGSIZE] != 'c' || arr[2 * PGSIZE] != 'd') {
+        printerr("pages have the wrong contents after wprotect()\n");
+        failed();
+    }
+
+    // unmapping the map removes every piece
+    if (wprotect(addr, PGSIZE, PROT_NONE) != SUCCESS || wunmap(addr) != SUCCESS) {
+        printerr("wprotect(PROT_NONE) or wunmap() failed\n");
+        failed();
+    }
+    get_n_validate_wmap_info(&info, 0);
+    success();
+}
@@ -0,0 +1,59 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_28
+// Summary: read() and write() on map pages that are not loaded yet
+// ====================================================================
+
+char *test_name = "TEST_28";
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    char *src = "test28_src.txt";
+    char *dst = "test28_dst.txt";
+    int filelength = create_big_file(src, 2, 'a');
+    uint addr = MMAPBASE;
+    int length = 2 * PGSIZE;
+    int anon = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS;
+    struct wmapinfo info;
+
+    if (wmap(addr, length, anon, -1) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    get_n_validate_wmap_info(&info, 1);
+    map_allocated(&info, addr, length, 0);
+
+    // read() straight into the untouched map
+    int fd = open_file(src, filelength);
+    char *arr = (char *)addr;
+    if (read(fd, arr, length) != length) {
+        printerr("read() into the map failed\n");
+        failed();
+    }
+    close(fd);
+    get_n_validate_wmap_info(&info, 1);
+    map_allocated(&info, addr, length, 2);
+    if (arr[0] != 'a' || arr[PGSIZE - 1] != 'a' || arr[PGSIZE] != 'b' ||
+        arr[length - 1] != 'b') {
+        printerr("map has the wrong contents after read()\n");
+        failed();
+    }
+
+    // write() from the map back out to a file
+    fd = open(dst, O_CREATE | O_RDWR);
+    if (fd < 0 || write(fd, arr + PGSIZE / 2, PGSIZE) != PGSIZE) {
+        printerr("write() from the map failed\n");
+        failed();
+    }
+    close(fd);
+    open_file(dst, PGSIZE);
+
+    if (wunmap(addr) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    get_n_validate_wmap_info(&info, 0);
+    success();
+}
@@ -0,0 +1,65 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_29
+// Summary: read() into an unmapped or read-only map address fails cleanly
+// ====================================================================
+
+char *test_name = "TEST_29";
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    char *filename = "test29.txt";
+    int filelength = create_small_file(filename, 'a');
+    uint addr = MMAPBASE;
+    int length = 2 * PGSIZE;
+    int anon = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS;
+
+    if (wmap(addr, length, anon, -1) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    if (wprotect(addr + PGSIZE, PGSIZE, PROT_READ) != SUCCESS) {
+        printerr("wprotect() failed\n");
+        failed();
+    }
+
+    int fd = open_file(filename, filelength);
+    char *arr = (char *)addr;
+    // just past the map
+    if (read(fd, arr + length, filelength) != FAILED) {
+        printerr("read() into an unmapped address succeeded\n");
+        failed();
+    }
+    // into the read-only page
+    if (read(fd, arr + PGSIZE, filelength) != FAILED) {
+        printerr("read() into a read-only page succeeded\n");
+        failed();
+    }
+    // running off the end of the writable page
+    if (read(fd, arr + PGSIZE - 16, filelength) != FAILED) {
+        printerr("read() across into a read-only page succeeded\n");
+        failed();
+    }
+    // from an unmapped address
+    if (write(fd, arr + length, filelength) != FAILED) {
+        printerr("write() from an unmapped address succeeded\n");
+        failed();
+    }
+    close(fd);
+
+    // the process and the map still work
+    fd = open_file(filename, filelength);
+    if (read(fd, arr, filelength) != filelength || arr[0] != 'a' ||
+        arr[filelength - 1] != 'a') {
+        printerr("read() into the map failed\n");
+        failed();
+    }
+    close(fd);
+    if (wunmap(addr) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    success();
+}
@@ -0,0 +1,114 @@
+#include "tester.h"
+#include "memstat.h"
+
+// ====================================================================
+// TEST_30
+// Summary: GETMEMSTAT: faults and rss follow map faults, COW and unmap
+// ====================================================================
+
+char *test_name = "TEST_30";
+
+char heap_page[PGSIZE];
+
+void get_memstat(int pid, struct memstat *st) {
+    if (getmemstat(pid, st) != SUCCESS) {
+        printerr("getmemstat(%d) failed\n", pid);
+        failed();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    char *filename = "test30.txt";
+    int filelength = create_big_file(filename, 2, 'a');
+    uint addr = MMAPBASE;
+    uint faddr = MMAPBASE + 0x100000;
+    int length = 4 * PGSIZE;
+    int anon = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS;
+    struct memstat before, after, sys;
+    struct wmapinfo info;
+
+    get_memstat(getpid(), &before);
+    if (before.rss == 0 || before.ptpages == 0) {
+        printerr("rss %d, ptpages %d\n", before.rss, before.ptpages);
+        failed();
+    }
+
+    // two zero-filled pages
+    if (wmap(addr, length, anon, -1) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    char *arr = (char *)addr;
+    arr[0] = 'x';
+    arr[2 * PGSIZE] = 'y';
+
+    // one page read from a file
+    int fd = open_file(filename, filelength);
+    if (wmap(faddr, filelength, MAP_FIXED | MAP_SHARED, fd) != faddr) {
+        printerr("wmap() of the file failed\n");
+        failed();
+    }
+    char *farr = (char *)faddr;
+    if (farr[PGSIZE] != 'b') {
+        printerr("file map has the wrong contents\n");
+        failed();
+    }
+
+    get_memstat(getpid(), &after);
+    if (after.zerofill - before.zerofill != 2 || after.fileread - before.fileread != 1 ||
+        after.majflt - before.majflt < 1 || after.rss - before.rss != 3) {
+        printerr("zerofill +%d, fileread +%d, majflt +%d, rss +%d\n",
+                 after.zerofill - before.zerofill, after.fileread - before.fileread,
+                 after.majflt - before.majflt, after.rss - before.rss);
+        failed();
+    }
+    get_n_validate_wmap_info(&info, 2);
+    map_allocated(&info, addr, length, 2);
+    map_allocated(&info, faddr, filelength, 1);
+
+    // the whole system has at least as much
+    get_memstat(0, &sys);
+    if (sys.rss < after.rss || sys.zerofill < after.zerofill ||
+        sys.ptpages < after.ptpages) {
+        printerr("system rss %d, zerofill %d less than ours\n", sys.rss, sys.zerofill);
+        failed();
+    }
+
+    // a write to a heap page after fork breaks COW in the child
+    int p[2];
+    char ok = 0;
+    pipe(p);
+    int pid = fork();
+    if (pid == 0) {
+        struct memstat child;
+        get_memstat(getpid(), &child);
+        heap_page[0] = 'c';
+        get_memstat(getpid(), &after);
+        ok = after.cowflt > child.cowflt && child.rss == before.rss + 3;
+        write(p[1], &ok, 1);
+        exit();
+    }
+    wait();
+    if (read(p[0], &ok, 1) != 1 || !ok) {
+        printerr("child saw no COW fault, or the wrong rss\n");
+        failed();
+    }
+
+    if (wunmap(addr) != SUCCESS || wunmap(faddr) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    close(fd);
+    get_memstat(getpid(), &after);
+    if (after.rss != before.rss) {
+        printerr("rss %d after wunmap(), expected %d\n", after.rss, before.rss);
+        failed();
+    }
+    if (getmemstat(-1, &after) != FAILED) {
+        printerr("getmemstat() of a bad pid succeeded\n");
+        failed();
+    }
+    success();
+}
@@ -0,0 +1,101 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_31
+// Summary: PAGEMAP: residency of a map, and sharing after fork
+// ====================================================================
+
+char *test_name = "TEST_31";
+
+#define NPAGES 8
+char heap[2 * PGSIZE];
+
+void get_pagemap(uint va, int n, struct pagemapent *ents) {
+    if (pagemap(va, n, ents) != n) {
+        printerr("pagemap(0x%x, %d) failed\n", va, n);
+        failed();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    uint addr = MMAPBASE;
+    int anon = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS;
+    struct pagemapent ents[NPAGES], hp[1], hc[1];
+
+    if (wmap(addr, NPAGES * PGSIZE, anon, -1) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    char *arr = (char *)addr;
+    for (int i = 0; i < NPAGES; i += 2)
+        arr[i * PGSIZE] = 'a';
+
+    get_pagemap(addr, NPAGES, ents);
+    for (int i = 0; i < NPAGES; i++) {
+        int present = (ents[i].flags & PM_PRESENT) != 0;
+        if (present != (i % 2 == 0)) {
+            printerr("page %d present %d, expected %d\n", i, present, i % 2 == 0);
+            failed();
+        }
+        if (present && (ents[i].refs != 1 || !(ents[i].flags & PM_WRITE) ||
+                        ents[i].pfn != get_n_validate_va2pa(addr + i * PGSIZE) >> 12)) {
+            printerr("page %d: pfn 0x%x refs %d flags 0x%x\n", i, ents[i].pfn,
+                     ents[i].refs, ents[i].flags);
+            failed();
+        }
+    }
+
+    // outside user memory
+    if (pagemap(KERNBASE - PGSIZE, 2, ents) != FAILED) {
+        printerr("pagemap() across KERNBASE succeeded\n");
+        failed();
+    }
+
+    heap[PGSIZE] = 'p';
+    get_pagemap((uint)&heap[PGSIZE], 1, hp);
+
+    int p[2];
+    char ok = 0;
+    pipe(p);
+    int pid = fork();
+    if (pid == 0) {
+        struct pagemapent c[NPAGES];
+        // the map is shared: same frames, one more reference
+        get_pagemap(addr, NPAGES, c);
+        ok = 1;
+        for (int i = 0; i < NPAGES; i += 2)
+            if (c[i].pfn != ents[i].pfn || c[i].refs != 2)
+                ok = 0;
+        // the heap page is COW until written
+        get_pagemap((uint)&heap[PGSIZE], 1, hc);
+        if (hc[0].pfn != hp[0].pfn || !(hc[0].flags & PM_COW) || hc[0].refs != 2)
+            ok = 0;
+        heap[PGSIZE] = 'c';
+        get_pagemap((uint)&heap[PGSIZE], 1, hc);
+        if (hc[0].pfn == hp[0].pfn || (hc[0].flags & PM_COW) || hc[0].refs != 1 ||
+            !(hc[0].flags & PM_DIRTY))
+            ok = 0;
+        write(p[1], &ok, 1);
+        exit();
+    }
+    wait();
+    if (read(p[0], &ok, 1) != 1 || !ok) {
+        printerr("child's pagemap did not show the expected sharing\n");
+        failed();
+    }
+
+    if (wunmap(addr) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    get_pagemap(addr, NPAGES, ents);
+    for (int i = 0; i < NPAGES; i++) {
+        if (ents[i].flags != 0) {
+            printerr("page %d still mapped after wunmap()\n", i);
+            failed();
+        }
+    }
+    success();
+}
@@ -0,0 +1,58 @@
+#include "tester.h"
+#include "spawn.h"
+
+// ====================================================================
+// TEST_32
+// Summary: SPAWN: start a program with its output redirected
+// ====================================================================
+
+char *test_name = "TEST_32";
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    char *args[] = {"echo", "spawned", 0};
+    int p[2];
+    if (pipe(p) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+    // echo's stdout is the pipe; the child keeps no other end of it
+    struct spawnfa fa[] = {{1, p[1]}, {p[0], -1}, {p[1], -1}, {-1, -1}};
+    int pid = spawn(args[0], args, fa);
+    if (pid < 0) {
+        printerr("spawn(echo) failed\n");
+        failed();
+    }
+    close(p[1]);
+
+    char buf[32];
+    int n = 0, r;
+    while (n < sizeof(buf) - 1 && (r = read(p[0], buf + n, sizeof(buf) - 1 - n)) > 0)
+        n += r;
+    buf[n] = 0;
+    close(p[0]);
+    if (strcmp(buf, "spawned\n") != 0) {
+        printerr("read \"%s\" from the child\n", buf);
+        failed();
+    }
+    if (wait() != pid) {
+        printerr("wait() did not return the spawned child\n");
+        failed();
+    }
+
+    if (spawn("nosuchprogram", args, 0) != FAILED) {
+        printerr("spawn() of a missing program succeeded\n");
+        failed();
+    }
+    struct spawnfa bad[] = {{1, 15}, {-1, -1}};
+    if (spawn(args[0], args, bad) != FAILED) {
+        printerr("spawn() with a closed source descriptor succeeded\n");
+        failed();
+    }
+    if (wait() != -1) {
+        printerr("a failed spawn() left a child\n");
+        failed();
+    }
+    success();
+}
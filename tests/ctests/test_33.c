@@ -0,0 +1,84 @@
+#include "tester.h"
+#include "param.h"
+#include "sched.h"
+
+// ====================================================================
+// TEST_33
+// Summary: MLFQ: setpriority pins a level, getschedstats reports it
+// ====================================================================
+
+char *test_name = "TEST_33";
+
+void get_stats(int pid, struct schedstat *st) {
+    if (getschedstats(pid, st) != SUCCESS) {
+        printerr("getschedstats(%d) failed\n", pid);
+        failed();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    struct schedstat st;
+    int pid = getpid();
+
+    if (setpriority(pid, 1) != SUCCESS) {
+        printerr("setpriority(self, 1) failed\n");
+        failed();
+    }
+    get_stats(pid, &st);
+    if (st.level != 1 || !st.pinned || st.nsched == 0) {
+        printerr("level %d pinned %d nsched %d after pinning at 1\n",
+                 st.level, st.pinned, st.nsched);
+        failed();
+    }
+
+    if (setpriority(pid, NMLFQ) != FAILED || setpriority(pid, -2) != FAILED) {
+        printerr("setpriority() accepted a bad level\n");
+        failed();
+    }
+    if (setpriority(12345, 0) != FAILED || getschedstats(12345, &st) != FAILED) {
+        printerr("a nonexistent pid was accepted\n");
+        failed();
+    }
+
+    // A CPU-bound child pinned at the bottom level stays there,
+    // even across a priority boost.
+    int p[2];
+    pipe(p);
+    int child = fork();
+    if (child == 0) {
+        char go;
+        read(p[0], &go, 1);
+        int end = uptime() + 2 * MLFQBOOST;
+        volatile int x = 0;
+        while (uptime() < end)
+            x++;
+        get_stats(getpid(), &st);
+        char ok = st.level == NMLFQ - 1 && st.pinned && st.ticks > 0;
+        write(p[1], &ok, 1);
+        exit();
+    }
+    if (setpriority(child, NMLFQ - 1) != SUCCESS) {
+        printerr("setpriority(child, %d) failed\n", NMLFQ - 1);
+        failed();
+    }
+    char ok = 1;
+    write(p[1], &ok, 1);
+    wait();
+    if (read(p[0], &ok, 1) != 1 || !ok) {
+        printerr("pinned child left its level\n");
+        failed();
+    }
+
+    if (setpriority(pid, -1) != SUCCESS) {
+        printerr("setpriority(self, -1) failed\n");
+        failed();
+    }
+    get_stats(pid, &st);
+    if (st.pinned) {
+        printerr("still pinned after setpriority(self, -1)\n");
+        failed();
+    }
+    success();
+}
@@ -0,0 +1,111 @@
+#include "tester.h"
+#include "param.h"
+#include "sched.h"
+
+// ====================================================================
+// TEST_34
+// Summary: AFFINITY: setaffinity/getaffinity, inherited by fork,
+// moves a running process between CPUs
+// ====================================================================
+
+char *test_name = "TEST_34";
+
+struct schedstat get_stats(int pid) {
+    struct schedstat st;
+    if (getschedstats(pid, &st) != SUCCESS) {
+        printerr("getschedstats(%d) failed\n", pid);
+        failed();
+    }
+    return st;
+}
+
+// Wait up to a second for pid to have run on cpu.
+void wait_for_cpu(int pid, int cpu) {
+    for (int i = 0; i < 100 && get_stats(pid).cpu != cpu; i++)
+        sleep(1);
+    if (get_stats(pid).cpu != cpu) {
+        printerr("pid %d still on CPU %d, expected %d\n", pid, get_stats(pid).cpu, cpu);
+        failed();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    int pid = getpid();
+    struct cpustat cs;
+    int ncpu;
+
+    for (ncpu = 0; ncpu < NCPU && getcpustat(ncpu, &cs) == SUCCESS; ncpu++)
+        ;
+    if (ncpu < 2) {
+        printerr("%d CPU; run with CPUS=2 or more\n", ncpu);
+        failed();
+    }
+
+    if (setaffinity(pid, 0x2) != SUCCESS) {
+        printerr("setaffinity(self, 0x2) failed\n");
+        failed();
+    }
+    if (getaffinity(pid) != 0x2) {
+        printerr("getaffinity(self) = 0x%x, expected 0x2\n", getaffinity(pid));
+        failed();
+    }
+    // give the scheduler a chance to move us
+    sleep(2);
+    if (get_stats(pid).cpu != 1) {
+        printerr("last ran on CPU %d, expected 1\n", get_stats(pid).cpu);
+        failed();
+    }
+    setaffinity(pid, 0x1);
+    sleep(2);
+    if (get_stats(pid).cpu != 0) {
+        printerr("last ran on CPU %d, expected 0\n", get_stats(pid).cpu);
+        failed();
+    }
+
+    // no CPUs, or only CPUs that are not there
+    if (setaffinity(pid, 0) != FAILED || setaffinity(pid, 1 << ncpu) != FAILED) {
+        printerr("setaffinity() accepted a mask with no usable CPU\n");
+        failed();
+    }
+    if (setaffinity(12345, 0x1) != FAILED || getaffinity(12345) != FAILED) {
+        printerr("a nonexistent pid was accepted\n");
+        failed();
+    }
+
+    int p[2];
+    pipe(p);
+    if (fork() == 0) {
+        char ok = getaffinity(getpid()) == 0x1;
+        write(p[1], &ok, 1);
+        exit();
+    }
+    wait();
+    char ok = 0;
+    if (read(p[0], &ok, 1) != 1 || !ok) {
+        printerr("child did not inherit the affinity mask\n");
+        failed();
+    }
+
+    // a process spinning in user mode moves over when its mask
+    // changes, by IPI if it is running on the other CPU
+    int spinner = fork();
+    if (spinner == 0)
+        for (;;)
+            ;
+    wait_for_cpu(spinner, 0);
+    uint m0 = get_stats(spinner).migrations;
+    setaffinity(spinner, 0x2);
+    wait_for_cpu(spinner, 1);
+    setaffinity(spinner, 0x1);
+    wait_for_cpu(spinner, 0);
+    if (get_stats(spinner).migrations - m0 < 2) {
+        printerr("spinner changed CPU twice, %d migrations counted\n",
+                 get_stats(spinner).migrations - m0);
+        failed();
+    }
+    kill(spinner);
+    wait();
+    success();
+}
@@ -0,0 +1,62 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_35
+// Summary: TIMERS: concurrent sleepers wake after their own deadlines
+// ====================================================================
+
+char *test_name = "TEST_35";
+
+#define NSLEEPER 4
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    int p[2];
+    pipe(p);
+
+    // children sleep for different lengths, longest first; the pipe
+    // should see them in deadline order
+    int i;
+    for (i = 0; i < NSLEEPER; i++) {
+        if (fork() == 0) {
+            int n = (NSLEEPER - i) * 10;
+            int t0 = uptime();
+            sleep(n);
+            char c = uptime() - t0 >= n ? 'a' + i : '!';
+            write(p[1], &c, 1);
+            exit();
+        }
+    }
+    for (i = 0; i < NSLEEPER; i++)
+        wait();
+
+    char buf[NSLEEPER];
+    if (read(p[0], buf, NSLEEPER) != NSLEEPER) {
+        printerr("short read from the sleepers\n");
+        failed();
+    }
+    for (i = 0; i < NSLEEPER; i++) {
+        if (buf[i] == '!') {
+            printerr("a sleeper woke before its deadline\n");
+            failed();
+        }
+        if (buf[i] != 'a' + NSLEEPER - 1 - i) {
+            printerr("sleepers woke out of order\n");
+            failed();
+        }
+    }
+
+    // longer than level 0 of the wheel covers
+    int t0 = uptime();
+    sleep(150);
+    if (uptime() - t0 < 150) {
+        printerr("sleep(150) returned after %d ticks\n", uptime() - t0);
+        failed();
+    }
+    if (sleep(0) != 0 || sleep(-1) != 0) {
+        printerr("sleep() of no time failed\n");
+        failed();
+    }
+    success();
+}
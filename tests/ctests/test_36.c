@@ -0,0 +1,83 @@
+#include "tester.h"
+#include "clock.h"
+
+// ====================================================================
+// TEST_36
+// Summary: CLOCK: clock_gettime is monotonic, nanosleep is sub-tick
+// ====================================================================
+
+char *test_name = "TEST_36";
+
+#define MS 1000000ULL
+
+static uint64 now(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != SUCCESS) {
+        printerr("clock_gettime(CLOCK_MONOTONIC) failed\n");
+        failed();
+    }
+    if (ts.tv_nsec >= 1000000000) {
+        printerr("tv_nsec out of range: %d\n", ts.tv_nsec);
+        failed();
+    }
+    return (uint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    struct timespec ts;
+    if (clock_gettime(12345, &ts) != FAILED) {
+        printerr("clock_gettime() accepted an unknown clock\n");
+        failed();
+    }
+
+    uint64 t0 = now(), t1;
+    int i;
+    for (i = 0; i < 1000; i++) {
+        t1 = now();
+        if (t1 < t0) {
+            printerr("clock went backwards\n");
+            failed();
+        }
+        t0 = t1;
+    }
+
+    // agrees with the tick clock
+    t0 = now();
+    sleep(10);
+    t1 = now();
+    if (t1 - t0 < 90 * MS || t1 - t0 > 1000 * MS) {
+        printerr("sleep(10) took %d us\n", (uint)((t1 - t0) >> 10));
+        failed();
+    }
+
+    // never early, and well under a tick each
+    t0 = now();
+    for (i = 0; i < 10; i++) {
+        ts.tv_sec = 0;
+        ts.tv_nsec = 1000000;
+        uint64 s = now();
+        if (nanosleep(&ts) != SUCCESS) {
+            printerr("nanosleep() failed\n");
+            failed();
+        }
+        if (now() - s < MS) {
+            printerr("nanosleep(1ms) returned early\n");
+            failed();
+        }
+    }
+    t1 = now();
+    if (t1 - t0 > 60 * MS) {
+        printerr("10 x nanosleep(1ms) took %d us\n", (uint)((t1 - t0) >> 10));
+        failed();
+    }
+
+    ts.tv_sec = 0;
+    ts.tv_nsec = 1000000000;
+    if (nanosleep(&ts) != FAILED) {
+        printerr("nanosleep() accepted tv_nsec of a second\n");
+        failed();
+    }
+    success();
+}
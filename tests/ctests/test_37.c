@@ -0,0 +1,102 @@
+#include "tester.h"
+#include "param.h"
+#include "sched.h"
+
+// ====================================================================
+// TEST_37
+// Summary: IDLE: getcpustat reports halted time while everyone sleeps,
+// and an idle CPU's tick stops while a busy one's keeps going
+// ====================================================================
+
+char *test_name = "TEST_37";
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    struct cpustat before[NCPU], after[NCPU];
+    int n, i;
+
+    for (n = 0; n < NCPU && getcpustat(n, &before[n]) == SUCCESS; n++)
+        ;
+    if (n < 2) {
+        printerr("%d CPU; run with CPUS=2 or more\n", n);
+        failed();
+    }
+    // stay on CPU 0, so that looking doesn't wake the others
+    setaffinity(getpid(), 1);
+    sleep(1);
+    for (i = 0; i < n; i++)
+        getcpustat(i, &before[i]);
+    if (getcpustat(-1, &after[0]) != FAILED || getcpustat(n, &after[0]) != FAILED) {
+        printerr("getcpustat() accepted a CPU that is not there\n");
+        failed();
+    }
+
+    // nothing runs while we sleep, so every CPU should halt
+    sleep(30);
+    for (i = 0; i < n; i++) {
+        if (getcpustat(i, &after[i]) != SUCCESS) {
+            printerr("getcpustat(%d) failed\n", i);
+            failed();
+        }
+        if (after[i].idlems - before[i].idlems < 150) {
+            printerr("cpu%d idle for only %d of ~300 ms\n", i,
+                     after[i].idlems - before[i].idlems);
+            failed();
+        }
+        if (after[i].halts == before[i].halts) {
+            printerr("cpu%d never halted\n", i);
+            failed();
+        }
+        if (after[i].upms - before[i].upms < after[i].idlems - before[i].idlems) {
+            printerr("cpu%d idle longer than it was up\n", i);
+            failed();
+        }
+    }
+    // CPU 0 keeps time; the others stop their tick while idle
+    if (after[0].ticks - before[0].ticks < 30) {
+        printerr("cpu0 took %d ticks in sleep(30)\n", after[0].ticks - before[0].ticks);
+        failed();
+    }
+    for (i = 1; i < n; i++) {
+        if (after[i].ticks - before[i].ticks >= 30) {
+            printerr("cpu%d kept ticking while idle\n", i);
+            failed();
+        }
+        if (!after[i].nohz) {
+            printerr("cpu%d is idle with its tick running\n", i);
+            failed();
+        }
+    }
+
+    // keep CPU 1 busy: its tick runs again and it stops halting,
+    // while the rest go on idling
+    int spinner = fork();
+    if (spinner == 0) {
+        setaffinity(getpid(), 2);
+        for (;;)
+            ;
+    }
+    sleep(5);
+    for (i = 0; i < n; i++)
+        getcpustat(i, &before[i]);
+    sleep(30);
+    for (i = 0; i < n; i++)
+        getcpustat(i, &after[i]);
+    kill(spinner);
+    wait();
+    if (after[1].idlems - before[1].idlems > 30 || after[1].nohz) {
+        printerr("busy cpu1 idle for %d of ~300 ms\n", after[1].idlems - before[1].idlems);
+        failed();
+    }
+    if (after[1].ticks - before[1].ticks < 20) {
+        printerr("busy cpu1 took %d ticks in sleep(30)\n", after[1].ticks - before[1].ticks);
+        failed();
+    }
+    if (after[0].idlems - before[0].idlems < 150) {
+        printerr("cpu0 idle for only %d of ~300 ms beside a busy cpu1\n",
+                 after[0].idlems - before[0].idlems);
+        failed();
+    }
+    success();
+}
@@ -0,0 +1,89 @@
+#include "tester.h"
+#include "lockstat.h"
+
+// ====================================================================
+// TEST_38
+// Summary: LOCKSTAT: per-lock counts while on, frozen while off
+// ====================================================================
+
+char *test_name = "TEST_38";
+
+struct lockstat st[NLOCKSTAT];
+
+static struct lockstat *find(int n, char *name) {
+    int i;
+    for (i = 0; i < n; i++)
+        if (strcmp(st[i].name, name) == 0)
+            return &st[i];
+    printerr("no lock named %s\n", name);
+    failed();
+    return 0;
+}
+
+static void work(void) {
+    int i;
+    for (i = 0; i < 10; i++) {
+        if (fork() == 0)
+            exit();
+        wait();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    if (lockstat(LS_ON, 0, 0) != SUCCESS) {
+        printerr("lockstat(LS_ON) failed\n");
+        failed();
+    }
+    work();
+    if (lockstat(LS_OFF, 0, 0) != SUCCESS) {
+        printerr("lockstat(LS_OFF) failed\n");
+        failed();
+    }
+    int n = lockstat(LS_READ, st, NLOCKSTAT);
+    if (n <= 0) {
+        printerr("lockstat(LS_READ) returned %d\n", n);
+        failed();
+    }
+
+    struct lockstat *pt = find(n, "ptable");
+    if (pt->nlocks != 1 || pt->acquires < 10) {
+        printerr("ptable: %d locks, %d acquires\n", pt->nlocks, pt->acquires);
+        failed();
+    }
+    uint before = pt->acquires;
+    int i;
+    for (i = 0; i < n; i++) {
+        if (st[i].contended > st[i].acquires) {
+            printerr("%s: more contended than acquires\n", st[i].name);
+            failed();
+        }
+    }
+    if (find(n, "sleep lock")->nlocks < 2) {
+        printerr("locks of one name were not summed\n");
+        failed();
+    }
+
+    // off: counts stay put
+    work();
+    lockstat(LS_READ, st, NLOCKSTAT);
+    if (find(n, "ptable")->acquires != before) {
+        printerr("ptable counted while off\n");
+        failed();
+    }
+
+    // on again: counts start over
+    lockstat(LS_ON, 0, 0);
+    lockstat(LS_OFF, 0, 0);
+    lockstat(LS_READ, st, NLOCKSTAT);
+    if (find(n, "ptable")->acquires >= before) {
+        printerr("ptable counts not cleared\n");
+        failed();
+    }
+    if (lockstat(12345, 0, 0) != FAILED) {
+        printerr("lockstat() accepted an unknown op\n");
+        failed();
+    }
+    success();
+}
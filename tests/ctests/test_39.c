@@ -0,0 +1,80 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_39
+// Summary: USERFAULT: a fill goes only to the fault it names
+// ====================================================================
+
+char *test_name = "TEST_39";
+
+char page[PGSIZE];
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    uint uaddr = MMAPBASE;
+    uint raddr = MMAPBASE + 16 * PGSIZE;
+    int anon = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS;
+
+    // a shared page for the children's results
+    if (wmap(raddr, PGSIZE, anon, -1) != raddr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    volatile int *result = (int *)raddr;
+    result[0] = result[1] = 0;
+
+    // two unrelated userfault maps at the same address, each
+    // child making its own and naming us its handler
+    int parent = getpid();
+    int pid[2];
+    for (int c = 0; c < 2; c++) {
+        if ((pid[c] = fork()) == 0) {
+            if (wmap(uaddr, PGSIZE, anon | MAP_USERFAULT, -1) != uaddr ||
+                wfhandler(uaddr, parent) != SUCCESS)
+                exit();
+            char *arr = (char *)uaddr;
+            int v = arr[0];
+            for (int i = 0; i < PGSIZE; i++)
+                if (arr[i] != v)
+                    v = -1;
+            arr[1] = 'x';  // our own page: the other child must not see it
+            result[c] = v;
+            exit();
+        }
+    }
+
+    struct wfaultinfo info[2];
+    for (int i = 0; i < 2; i++) {
+        if (wfault(&info[i]) < 0 || info[i].addr != uaddr) {
+            printerr("wfault() failed\n");
+            failed();
+        }
+    }
+    int first = info[0].pid == pid[0] ? 0 : 1;
+
+    memset(page, 'A' + first, PGSIZE);
+    if (wfill(pid[first], uaddr, page) < 0) {
+        printerr("wfill() failed\n");
+        failed();
+    }
+    sleep(5);
+    if (result[first] != 'A' + first || result[1 - first] != 0) {
+        printerr("the fill reached the other child (%d, %d)\n", result[0], result[1]);
+        failed();
+    }
+
+    memset(page, 'A' + 1 - first, PGSIZE);
+    if (wfill(pid[1 - first], uaddr, page) < 0) {
+        printerr("second wfill() failed\n");
+        failed();
+    }
+    wait();
+    wait();
+    if (result[0] != 'A' || result[1] != 'B') {
+        printerr("children saw %d and %d, expected %d and %d\n",
+                 result[0], result[1], 'A', 'B');
+        failed();
+    }
+    success();
+}
@@ -0,0 +1,79 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_40
+// Summary: read() into a map of the same file, big unaligned read/write
+// ====================================================================
+
+char *test_name = "TEST_40";
+
+char big[5 * PGSIZE];
+
+void check(char *p, int n, char c, char *what) {
+    for (int i = 0; i < n; i++) {
+        if (p[i] != c) {
+            printerr("%s: byte %d is %d, expected %d\n", what, i, p[i], c);
+            failed();
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    char *src = "test40_src.txt";
+    char *dst = "test40_dst.txt";
+    int filelength = create_big_file(src, 4, 'a');
+    uint addr = MMAPBASE;
+    int filebacked = MAP_FIXED | MAP_SHARED;
+
+    // map the file, then read() its first two pages into
+    // map pages 1 and 2, none of which are loaded yet
+    int mapfd = open_file(src, filelength);
+    if (wmap(addr, filelength, filebacked, mapfd) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    int fd = open_file(src, filelength);
+    char *arr = (char *)addr;
+    if (read(fd, arr + PGSIZE, 2 * PGSIZE) != 2 * PGSIZE) {
+        printerr("read() into a map of the same file failed\n");
+        failed();
+    }
+    close(fd);
+    check(arr, PGSIZE, 'a', "map page 0");
+    check(arr + PGSIZE, PGSIZE, 'a', "map page 1");
+    check(arr + 2 * PGSIZE, PGSIZE, 'b', "map page 2");
+    check(arr + 3 * PGSIZE, PGSIZE, 'd', "map page 3");
+
+    // write() three pages from an unaligned map address
+    fd = open(dst, O_CREATE | O_RDWR);
+    if (fd < 0 || write(fd, arr + PGSIZE / 2, 3 * PGSIZE) != 3 * PGSIZE) {
+        printerr("write() from the map failed\n");
+        failed();
+    }
+    close(fd);
+
+    // read() it back to an unaligned buffer that is not touched
+    // yet; asking for more than the file holds stops at its end
+    fd = open_file(dst, 3 * PGSIZE);
+    if (read(fd, big + 7, 4 * PGSIZE) != 3 * PGSIZE) {
+        printerr("read() did not stop at the end of the file\n");
+        failed();
+    }
+    if (read(fd, big, PGSIZE) != 0) {
+        printerr("read() at the end of the file returned data\n");
+        failed();
+    }
+    close(fd);
+    check(big + 7, PGSIZE + PGSIZE / 2, 'a', "copy of map pages 0-1");
+    check(big + 7 + PGSIZE + PGSIZE / 2, PGSIZE, 'b', "copy of map page 2");
+    check(big + 7 + 2 * PGSIZE + PGSIZE / 2, PGSIZE / 2, 'd', "copy of map page 3");
+
+    if (wunmap(addr) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    close(mapfd);
+    success();
+}
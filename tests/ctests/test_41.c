@@ -0,0 +1,122 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_41
+// Summary: FORK: page tables shared down to a grandchild, writes stay
+// isolated, and references go back to one as the others exit
+// ====================================================================
+
+char *test_name = "TEST_41";
+
+#define PTSIZE (PGSIZE * 1024)
+#define NPAGES 4
+
+char *data;
+
+// Does this process see c at page i, with refs references
+// and flag set in its pagemap entry?
+int expect(char *who, int i, char c, uint refs, uint flag) {
+    struct pagemapent e;
+
+    if (pagemap((uint)data + i * PGSIZE, 1, &e) != 1) {
+        printerr("%s: pagemap() failed\n", who);
+        return 0;
+    }
+    if (data[i * PGSIZE] != c || e.refs != refs || !(e.flags & flag)) {
+        printerr("%s: page %d has '%c' refs %d flags 0x%x, expected '%c' refs %d\n",
+                 who, i, data[i * PGSIZE], e.refs, e.flags, c, refs);
+        return 0;
+    }
+    return 1;
+}
+
+void report(int fd, int ok) {
+    char c = ok;
+    write(fd, &c, 1);
+}
+
+int collect(int fd) {
+    char c = 0;
+    return read(fd, &c, 1) == 1 && c;
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    // Put the pages in a page table of their own, so that
+    // writes to the stack don't unshare it.
+    uint sz = (uint)sbrk(0);
+    if (sbrk(PTSIZE - sz % PTSIZE + NPAGES * PGSIZE) == (char *)-1) {
+        printerr("sbrk() failed\n");
+        failed();
+    }
+    data = (char *)(sz + PTSIZE - sz % PTSIZE);
+    for (int i = 0; i < NPAGES; i++)
+        data[i * PGSIZE] = 'p';
+
+    int cwrote[2], pwrote[2], res[2];
+    pipe(cwrote);
+    pipe(pwrote);
+    pipe(res);
+    int ok;
+
+    if (fork() == 0) {
+        // child: fork a grandchild while the table is still
+        // shared three ways, then write to page 0
+        if (fork() == 0) {
+            // grandchild: wait until both have written and
+            // left the table to it alone
+            collect(pwrote[0]);
+            ok = 1;
+            ok &= expect("grandchild", 0, 'p', 1, PM_COW);
+            for (int i = 1; i < NPAGES; i++)
+                ok &= expect("grandchild", i, 'p', 3, PM_COW);
+            data[PGSIZE] = 'g';
+            ok &= expect("grandchild", 1, 'g', 1, PM_WRITE);
+            ok &= expect("grandchild", 2, 'p', 3, PM_COW);
+            report(res[1], ok);
+            exit();
+        }
+        data[0] = 'c';
+        ok = expect("child", 0, 'c', 1, PM_WRITE);
+        report(cwrote[1], ok);
+        wait();
+        // the grandchild's exit dropped its references
+        ok = expect("child", 0, 'c', 1, PM_WRITE);
+        ok &= expect("child", 1, 'p', 2, PM_COW);
+        ok &= expect("child", 2, 'p', 2, PM_COW);
+        report(res[1], ok);
+        exit();
+    }
+
+    if (!collect(cwrote[0])) {
+        printerr("child's write was not isolated\n");
+        failed();
+    }
+    data[0] = 'P';
+    ok = expect("parent", 0, 'P', 1, PM_WRITE);
+    for (int i = 1; i < NPAGES; i++)
+        ok &= expect("parent", i, 'p', 3, PM_COW);
+    if (!ok)
+        failed();
+    report(pwrote[1], 1);
+
+    if (!collect(res[0])) {
+        printerr("grandchild did not see its own pages\n");
+        failed();
+    }
+    if (!collect(res[0])) {
+        printerr("child did not see its own pages\n");
+        failed();
+    }
+    wait();
+
+    // everyone else is gone: the pages are the parent's alone
+    for (int i = 1; i < NPAGES; i++)
+        if (!expect("parent", i, 'p', 1, PM_PRESENT))
+            failed();
+    data[PGSIZE] = 'x';
+    if (!expect("parent", 1, 'x', 1, PM_WRITE))
+        failed();
+    success();
+}
@@ -0,0 +1,109 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_42
+// Summary: SWAP: pages pushed out to disk under pressure come back
+// intact, in the parent and in a forked child
+// ====================================================================
+
+char *test_name = "TEST_42";
+
+#define PTSIZE (PGSIZE * 1024)
+#define OVER 256  // pages more than there is memory for
+
+// Word j of page i: mixed up, so pages don't compress and
+// have to go to the disk rather than the compressed pool.
+uint word(uint i, uint j) {
+    uint x = (i << 10 | j) * 2654435761U;
+    return x ^ (x >> 15) ^ (i * 40503);
+}
+
+uint *heap;
+uint npages;
+
+// Check every page, or with skip 8, that pages 0, 8, 16, ...
+// hold mark in their first word instead.
+int check(char *who, int skip, uint mark) {
+    for (uint i = 0; i < npages; i++) {
+        uint *w = heap + i * (PGSIZE / 4);
+        for (uint j = 0; j < PGSIZE / 4; j++) {
+            uint want = skip && i % skip == 0 && j == 0 ? mark : word(i, j);
+            if (w[j] != want) {
+                printerr("%s: page %d word %d is 0x%x, expected 0x%x\n", who, i, j,
+                         w[j], want);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Write to one page under each page table of [p, p+n), so that
+// after fork this process has its own tables, from which reclaim
+// may take pages; it leaves tables still shared alone.
+void unshare(char *p, uint n) {
+    for (uint a = (uint)p; a < (uint)p + n; a = (a + PTSIZE) & ~(PTSIZE - 1))
+        *(volatile char *)a = *(volatile char *)a;
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    struct swapstat s0, s1, s2, s3;
+    int hold = hold_memory(512);
+
+    getswapstat(&s0);
+    npages = s0.freepages + OVER;
+    if ((heap = (uint *)sbrk(npages * PGSIZE)) == (uint *)-1) {
+        printerr("sbrk(%d pages) failed\n", npages);
+        failed();
+    }
+    for (uint i = 0; i < npages; i++)
+        for (uint j = 0; j < PGSIZE / 4; j++)
+            heap[i * (PGSIZE / 4) + j] = word(i, j);
+    getswapstat(&s1);
+    if (s1.swapouts - s0.swapouts < OVER / 2 || s1.used <= s0.used) {
+        printerr("%d pages over, but %d swapped out, %d slots in use\n", OVER,
+                 s1.swapouts - s0.swapouts, s1.used);
+        failed();
+    }
+
+    // the child shares the swapped-out pages, reads them all,
+    // then writes to some of them
+    int p[2];
+    char ok;
+    pipe(p);
+    if (fork() == 0) {
+        unshare((char *)heap, npages * PGSIZE);
+        ok = check("child", 0, 0);
+        for (uint i = 0; i < npages; i += 8)
+            heap[i * (PGSIZE / 4)] = 0xc0ffee;
+        ok &= check("child", 8, 0xc0ffee);
+        write(p[1], &ok, 1);
+        exit();
+    }
+    wait();
+    if (read(p[0], &ok, 1) != 1 || !ok) {
+        printerr("child did not get its pages back intact\n");
+        failed();
+    }
+    unshare((char *)heap, npages * PGSIZE);
+    if (!check("parent", 0, 0))
+        failed();
+    getswapstat(&s2);
+    if (s2.swapins <= s1.swapins) {
+        printerr("no pages were swapped back in\n");
+        failed();
+    }
+
+    // giving the memory back frees its swap slots
+    sbrk(-npages * PGSIZE);
+    getswapstat(&s3);
+    if (s3.used > s0.used) {
+        printerr("%d swap slots in use after sbrk(), %d before\n", s3.used, s0.used);
+        failed();
+    }
+    close(hold);
+    wait();
+    success();
+}
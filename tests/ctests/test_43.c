@@ -0,0 +1,114 @@
+#include "tester.h"
+#include "memstat.h"
+
+// ====================================================================
+// TEST_43
+// Summary: RECLAIM: cold pages of a file map are dropped under
+// pressure, dirty ones written back first, and fault back in
+// ====================================================================
+
+char *test_name = "TEST_43";
+
+#define NFILEPAGES 16
+#define OVER 64    // heap pages more than there is memory for
+#define MAXPASS 200
+
+char buf[PGSIZE];
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    char *filename = "test43.txt";
+    int filelength = create_big_file(filename, NFILEPAGES, 'a');
+    uint addr = MMAPBASE;
+    int fd = open_file(filename, filelength);
+    if (wmap(addr, filelength, MAP_FIXED | MAP_SHARED, fd) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    close(fd);
+
+    // read the first half, write to the second
+    char *arr = (char *)addr;
+    for (int i = 0; i < NFILEPAGES / 2; i++)
+        if (arr[i * PGSIZE] != 'a' + i) {
+            printerr("page %d of the map has the wrong contents\n", i);
+            failed();
+        }
+    for (int i = NFILEPAGES / 2; i < NFILEPAGES; i++)
+        arr[i * PGSIZE] = 'A' + i;
+
+    int hold = hold_memory(OVER);
+    struct memstat m0, m1;
+    struct swapstat st;
+    struct pagemapent ents[NFILEPAGES];
+    getmemstat(getpid(), &m0);
+
+    // Keep going over a heap that doesn't quite fit, and leave the
+    // map alone, until every page of the map has been reclaimed.
+    getswapstat(&st);
+    int npages = st.freepages + OVER;
+    char *heap = sbrk(npages * PGSIZE);
+    if (heap == (char *)-1) {
+        printerr("sbrk(%d pages) failed\n", npages);
+        failed();
+    }
+    for (int i = 0; i < npages; i++)
+        memset(heap + i * PGSIZE, i, PGSIZE);
+    int pass, left;
+    for (pass = 0; pass < MAXPASS; pass++) {
+        if (pagemap(addr, NFILEPAGES, ents) != NFILEPAGES) {
+            printerr("pagemap() failed\n");
+            failed();
+        }
+        for (left = 0; left < NFILEPAGES; left++)
+            if (ents[left].flags & PM_PRESENT)
+                break;
+        if (left == NFILEPAGES)
+            break;
+        for (int i = 0; i < npages; i++)
+            if (heap[i * PGSIZE + PGSIZE - 1] != (char)i) {
+                printerr("heap page %d has the wrong contents\n", i);
+                failed();
+            }
+    }
+    if (pass == MAXPASS) {
+        printerr("page %d of the map was never reclaimed\n", left);
+        failed();
+    }
+
+    // the dirty pages went to the file before they were dropped
+    fd = open_file(filename, filelength);
+    for (int i = 0; i < NFILEPAGES; i++) {
+        char want = i < NFILEPAGES / 2 ? 'a' + i : 'A' + i;
+        if (read(fd, buf, PGSIZE) != PGSIZE || buf[0] != want || buf[1] != 'a' + i) {
+            printerr("page %d of the file was not written back\n", i);
+            failed();
+        }
+    }
+    close(fd);
+
+    // and the map reads them back from the file
+    for (int i = 0; i < NFILEPAGES; i++) {
+        char want = i < NFILEPAGES / 2 ? 'a' + i : 'A' + i;
+        if (arr[i * PGSIZE] != want || arr[i * PGSIZE + 1] != 'a' + i) {
+            printerr("page %d of the map came back wrong\n", i);
+            failed();
+        }
+    }
+    getmemstat(getpid(), &m1);
+    if (m1.fileread - m0.fileread < NFILEPAGES) {
+        printerr("%d pages read from the file, expected %d\n",
+                 m1.fileread - m0.fileread, NFILEPAGES);
+        failed();
+    }
+
+    sbrk(-npages * PGSIZE);
+    if (wunmap(addr) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    close(hold);
+    wait();
+    success();
+}
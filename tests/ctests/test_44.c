@@ -0,0 +1,114 @@
+#include "tester.h"
+#include "ksm.h"
+
+// ====================================================================
+// TEST_44
+// Summary: KSM: identical pages of a mergeable map are merged, and a
+// write to one is seen only by the writer
+// ====================================================================
+
+char *test_name = "TEST_44";
+
+#define NPAGES 32
+#define HALF (NPAGES / 2)
+#define TIMEOUT 2000  // ticks
+
+struct pagemapent ents[NPAGES];
+
+void get_pagemap(uint va) {
+    if (pagemap(va, NPAGES, ents) != NPAGES) {
+        printerr("pagemap() failed\n");
+        failed();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    uint addr = MMAPBASE;
+    int flags = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS | MAP_MERGEABLE;
+    struct ksmstat k0, k;
+
+    if (wmap(addr, NPAGES * PGSIZE, flags, -1) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    char *arr = (char *)addr;
+    for (int i = 0; i < NPAGES; i++)
+        memset(arr + i * PGSIZE, i < HALF ? 'k' : 'm', PGSIZE);
+    getksmstat(&k0);
+
+    // ksmd only looks at a process preempted in user mode: share
+    // CPU 0 with a spinner, and leave the other CPU to ksmd
+    setaffinity(getpid(), 1);
+    int spinner = fork();
+    if (spinner == 0)
+        for (;;)
+            ;
+    uint t0 = uptime();
+    volatile int x;
+    do {
+        for (x = 0; x < 1000000; x++)
+            ;
+        getksmstat(&k);
+    } while (k.merged - k0.merged < NPAGES - 2 && uptime() - t0 < TIMEOUT);
+    kill(spinner);
+    wait();
+    if (k.merged - k0.merged < NPAGES - 2 || k.saved < NPAGES - 2) {
+        printerr("%d pages merged, %d frames saved, expected %d\n",
+                 k.merged - k0.merged, k.saved, NPAGES - 2);
+        failed();
+    }
+
+    // each half is one read-only frame now
+    get_pagemap(addr);
+    for (int i = 0; i < NPAGES; i++) {
+        int first = i < HALF ? 0 : HALF;
+        if (ents[i].pfn != ents[first].pfn || !(ents[i].flags & PM_COW) ||
+            ents[i].refs <= HALF || arr[i * PGSIZE] != (i < HALF ? 'k' : 'm')) {
+            printerr("page %d: pfn 0x%x refs %d flags 0x%x\n", i, ents[i].pfn,
+                     ents[i].refs, ents[i].flags);
+            failed();
+        }
+    }
+    if (ents[0].pfn == ents[HALF].pfn) {
+        printerr("pages with different contents were merged\n");
+        failed();
+    }
+
+    // a write gives the page its own frame again; the pages
+    // it was merged with keep the old contents
+    arr[3 * PGSIZE] = 'w';
+    get_pagemap(addr);
+    if (ents[3].pfn == ents[2].pfn || (ents[3].flags & PM_COW) || ents[3].refs != 1) {
+        printerr("written page still merged: refs %d flags 0x%x\n", ents[3].refs,
+                 ents[3].flags);
+        failed();
+    }
+    for (int i = 0; i < HALF; i++) {
+        if (arr[i * PGSIZE] != (i == 3 ? 'w' : 'k') || arr[i * PGSIZE + 1] != 'k') {
+            printerr("page %d changed by a write to page 3\n", i);
+            failed();
+        }
+    }
+
+    // after fork the map is still shared with the child, merged
+    // pages and all
+    if (fork() == 0) {
+        if (arr[3 * PGSIZE] != 'w')
+            exit();
+        arr[5 * PGSIZE] = 'c';
+        exit();
+    }
+    wait();
+    if (arr[5 * PGSIZE] != 'c' || arr[6 * PGSIZE] != 'k' || arr[HALF * PGSIZE] != 'm') {
+        printerr("child's write was not shared as it should be\n");
+        failed();
+    }
+
+    if (wunmap(addr) != SUCCESS) {
+        printerr("wunmap() failed\n");
+        failed();
+    }
+    success();
+}
@@ -0,0 +1,110 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_45
+// Summary: ZSWAP: compressible pages are kept compressed in memory
+// under pressure and decompress intact, in the parent and a child
+// ====================================================================
+
+char *test_name = "TEST_45";
+
+#define PTSIZE (PGSIZE * 1024)
+#define OVER 256  // pages more than there is memory for
+
+char *heap;
+int npages;
+
+// Page i: its number, then a run of one letter.
+void fill(int i) {
+    char *p = heap + i * PGSIZE;
+    memset(p, 'a' + i % 26, PGSIZE);
+    *(int *)p = i;
+}
+
+int check(char *who) {
+    for (int i = 0; i < npages; i++) {
+        char *p = heap + i * PGSIZE;
+        if (*(int *)p != i || p[4] != 'a' + i % 26 || p[PGSIZE - 1] != 'a' + i % 26) {
+            printerr("%s: page %d has the wrong contents\n", who, i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Write to one page under each page table of [p, p+n), so that
+// after fork this process has its own tables, from which reclaim
+// may take pages; it leaves tables still shared alone.
+void unshare(char *p, uint n) {
+    for (uint a = (uint)p; a < (uint)p + n; a = (a + PTSIZE) & ~(PTSIZE - 1))
+        *(volatile char *)a = *(volatile char *)a;
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    struct swapstat s0, s1, s2, s3;
+    int hold = hold_memory(512);
+
+    getswapstat(&s0);
+    npages = s0.freepages + OVER;
+    if ((heap = sbrk(npages * PGSIZE)) == (char *)-1) {
+        printerr("sbrk(%d pages) failed\n", npages);
+        failed();
+    }
+    for (int i = 0; i < npages; i++)
+        fill(i);
+    getswapstat(&s1);
+    int zouts = s1.zouts - s0.zouts;
+    if (zouts < OVER / 2 || s1.zstored <= s0.zstored) {
+        printerr("%d pages over, but %d compressed, %d stored\n", OVER, zouts,
+                 s1.zstored);
+        failed();
+    }
+    if (s1.zpages > s1.zmaxpages || s1.zbytes > s1.zstored * (PGSIZE / 4)) {
+        printerr("pool holds %d pages in %d bytes, %d pool pages of %d\n",
+                 s1.zstored, s1.zbytes, s1.zpages, s1.zmaxpages);
+        failed();
+    }
+    // they went to the pool, not to the disk
+    if (s1.swapouts - s0.swapouts > zouts) {
+        printerr("%d pages written to disk, %d compressed\n",
+                 s1.swapouts - s0.swapouts, zouts);
+        failed();
+    }
+
+    int p[2];
+    char ok;
+    pipe(p);
+    if (fork() == 0) {
+        unshare(heap, npages * PGSIZE);
+        ok = check("child");
+        write(p[1], &ok, 1);
+        exit();
+    }
+    wait();
+    if (read(p[0], &ok, 1) != 1 || !ok) {
+        printerr("child did not get its pages back intact\n");
+        failed();
+    }
+    unshare(heap, npages * PGSIZE);
+    if (!check("parent"))
+        failed();
+    getswapstat(&s2);
+    if (s2.zins <= s1.zins) {
+        printerr("no pages were decompressed\n");
+        failed();
+    }
+
+    // giving the memory back empties the pool again
+    sbrk(-npages * PGSIZE);
+    getswapstat(&s3);
+    if (s3.zstored > s0.zstored || s3.used > s0.used) {
+        printerr("%d pages still compressed, %d slots in use\n", s3.zstored,
+                 s3.used);
+        failed();
+    }
+    close(hold);
+    wait();
+    success();
+}
@@ -0,0 +1,115 @@
+#include "tester.h"
+#include "memstat.h"
+#include "sched.h"
+
+// ====================================================================
+// TEST_46
+// Summary: FAULTHIST: zero-fill, file and COW faults each land in
+// their own latency histogram, per CPU and summed
+// ====================================================================
+
+char *test_name = "TEST_46";
+
+#define NANON 16
+#define NFILE 4
+#define NCOW 8
+#define MINBIN 6  // no fault is handled in under 64 cycles
+
+char heap[NCOW * PGSIZE];
+
+uint total(struct faulthist *h, int kind) {
+    uint n = 0;
+    for (int b = 0; b < NFAULTBIN; b++)
+        n += h->count[kind][b];
+    return n;
+}
+
+void get_hist(int cpu, struct faulthist *h) {
+    if (getfaulthist(cpu, h) != SUCCESS) {
+        printerr("getfaulthist(%d) failed\n", cpu);
+        failed();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    struct faulthist h0, h1, hc;
+    char *filename = "test46.txt";
+    int filelength = create_big_file(filename, NFILE, 'a');
+    for (int i = 0; i < NCOW; i++)
+        heap[i * PGSIZE] = 'p';
+    get_hist(-1, &h0);
+
+    // anonymous map pages are zero-filled when first touched
+    uint addr = MMAPBASE;
+    if (wmap(addr, NANON * PGSIZE, MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS, -1) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    for (int i = 0; i < NANON; i++)
+        ((char *)addr)[i * PGSIZE] = 'z';
+
+    // file map pages are read in
+    uint faddr = MMAPBASE + 0x100000;
+    int fd = open_file(filename, filelength);
+    if (wmap(faddr, filelength, MAP_FIXED | MAP_SHARED, fd) != faddr) {
+        printerr("wmap() of the file failed\n");
+        failed();
+    }
+    for (int i = 0; i < NFILE; i++)
+        if (((char *)faddr)[i * PGSIZE] != 'a' + i) {
+            printerr("file page %d has the wrong contents\n", i);
+            failed();
+        }
+
+    // a child's writes copy the pages it shares with us
+    if (fork() == 0) {
+        for (int i = 0; i < NCOW; i++)
+            heap[i * PGSIZE] = 'c';
+        exit();
+    }
+    wait();
+    get_hist(-1, &h1);
+
+    uint zero = total(&h1, FK_ZERO) - total(&h0, FK_ZERO);
+    uint file = total(&h1, FK_FILE) - total(&h0, FK_FILE);
+    uint cow = total(&h1, FK_COW) - total(&h0, FK_COW);
+    if (zero < NANON || file < NFILE || cow < NCOW) {
+        printerr("%d zero-fill, %d file, %d cow faults; expected %d, %d, %d\n", zero,
+                 file, cow, NANON, NFILE, NCOW);
+        failed();
+    }
+    for (int k = 0; k < NFAULTKIND; k++)
+        for (int b = 0; b < MINBIN; b++)
+            if (h1.count[k][b] != h0.count[k][b]) {
+                printerr("kind %d: a fault took under %d cycles\n", k, 1 << (b + 1));
+                failed();
+            }
+
+    // the CPUs' histograms add up to the total
+    struct cpustat cs;
+    memset(&h0, 0, sizeof(h0));
+    for (int c = 0; getcpustat(c, &cs) == SUCCESS; c++) {
+        get_hist(c, &hc);
+        for (int k = 0; k < NFAULTKIND; k++)
+            for (int b = 0; b < NFAULTBIN; b++)
+                h0.count[k][b] += hc.count[k][b];
+    }
+    get_hist(-1, &h1);
+    for (int k = 0; k < NFAULTKIND; k++)
+        if (total(&h0, k) != total(&h1, k)) {
+            printerr("kind %d: CPUs add up to %d, total is %d\n", k, total(&h0, k),
+                     total(&h1, k));
+            failed();
+        }
+    if (getfaulthist(64, &hc) != FAILED) {
+        printerr("getfaulthist() accepted a CPU that is not there\n");
+        failed();
+    }
+
+    wunmap(addr);
+    wunmap(faddr);
+    close(fd);
+    success();
+}
@@ -0,0 +1,113 @@
+#include "tester.h"
+#include "lockstat.h"
+
+// ====================================================================
+// TEST_47
+// Summary: REAPER: an exited process's memory comes back, freed in
+// batches by the reaper thread rather than a page at a time
+// ====================================================================
+
+char *test_name = "TEST_47";
+
+#define NPAGES 1024
+#define NKIDS 16
+#define KIDPAGES 64
+
+struct lockstat st[NLOCKSTAT];
+
+static uint freepages(void) {
+    struct swapstat ss;
+    if (getswapstat(&ss) != SUCCESS) {
+        printerr("getswapstat() failed\n");
+        failed();
+    }
+    return ss.freepages;
+}
+
+// Wait up to 100 ticks for at least want pages to be free.
+static void wait_for_free(uint want) {
+    int i;
+    for (i = 0; i < 100 && freepages() < want; i++)
+        sleep(1);
+    if (freepages() < want) {
+        printerr("%d pages free, expected %d\n", freepages(), want);
+        failed();
+    }
+}
+
+static struct lockstat *find(int n, char *name) {
+    int i;
+    for (i = 0; i < n; i++)
+        if (strcmp(st[i].name, name) == 0)
+            return &st[i];
+    printerr("no lock named %s\n", name);
+    failed();
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    int go[2], ready[2], i;
+    char c;
+    uint start = freepages();
+
+    // one big exit: its pages go back in batches
+    if (pipe(go) < 0 || pipe(ready) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+    if (fork() == 0) {
+        close(go[1]);
+        c = sbrk(NPAGES * PGSIZE) != (char *)-1;
+        write(ready[1], &c, 1);
+        read(go[0], &c, 1);
+        exit();
+    }
+    close(go[0]);
+    if (read(ready[0], &c, 1) != 1 || !c) {
+        printerr("child could not grow\n");
+        failed();
+    }
+    uint base = freepages();
+    lockstat(LS_ON, 0, 0);
+    close(go[1]);
+    wait();
+    wait_for_free(base + NPAGES);
+    lockstat(LS_OFF, 0, 0);
+    int n = lockstat(LS_READ, st, NLOCKSTAT);
+    struct lockstat *km = find(n, "kmem");
+    if (km->acquires >= NPAGES / 8) {
+        printerr("kmem taken %d times to free %d pages\n", km->acquires, NPAGES);
+        failed();
+    }
+    if (find(n, "reap")->acquires == 0) {
+        printerr("the reaper was not handed the address space\n");
+        failed();
+    }
+    close(ready[0]);
+    close(ready[1]);
+
+    // many exits at once: all of it comes back
+    if (pipe(go) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+    for (i = 0; i < NKIDS; i++) {
+        if (fork() == 0) {
+            close(go[1]);
+            sbrk(KIDPAGES * PGSIZE);
+            read(go[0], &c, 1);
+            exit();
+        }
+    }
+    close(go[0]);
+    close(go[1]);
+    for (i = 0; i < NKIDS; i++)
+        if (wait() < 0) {
+            printerr("lost a child\n");
+            failed();
+        }
+    wait_for_free(start - 4);
+    success();
+}
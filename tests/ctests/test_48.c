@@ -0,0 +1,68 @@
+#include "tester.h"
+#include "param.h"
+#include "sched.h"
+
+// ====================================================================
+// TEST_48
+// Summary: KTHREAD: kernel threads can't be killed or reprioritised;
+// a CPU-bound process sinks to the bottom MLFQ level and is boosted
+// ====================================================================
+
+char *test_name = "TEST_48";
+
+#define NKTHREAD 2  // the reaper and ksmd
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    struct schedstat st;
+    int pid, n = 0;
+
+    for (pid = 1; pid < getpid(); pid++) {
+        if (getschedstats(pid, &st) != SUCCESS || st.level != -1)
+            continue;
+        n++;
+        if (kill(pid) != FAILED) {
+            printerr("killed kernel thread %d\n", pid);
+            failed();
+        }
+        if (setpriority(pid, 0) != FAILED) {
+            printerr("setpriority() on kernel thread %d\n", pid);
+            failed();
+        }
+        if (getschedstats(pid, &st) != SUCCESS || st.level != -1) {
+            printerr("kernel thread %d went away\n", pid);
+            failed();
+        }
+    }
+    if (n < NKTHREAD) {
+        printerr("found %d kernel threads, expected %d\n", n, NKTHREAD);
+        failed();
+    }
+
+    // A CPU-bound child uses up its quanta down to the bottom level,
+    // then a boost puts it back at the top for a while.
+    int p[2];
+    pipe(p);
+    if (fork() == 0) {
+        int sank = 0, boosted = 0;
+        int end = uptime() + 3 * MLFQBOOST;
+        while (uptime() < end && !boosted) {
+            getschedstats(getpid(), &st);
+            if (st.level == NMLFQ - 1)
+                sank = 1;
+            else if (sank)
+                boosted = 1;
+        }
+        char ok = sank && boosted && !st.pinned;
+        write(p[1], &ok, 1);
+        exit();
+    }
+    wait();
+    char ok;
+    if (read(p[0], &ok, 1) != 1 || !ok) {
+        printerr("CPU-bound child was not demoted and boosted\n");
+        failed();
+    }
+    success();
+}
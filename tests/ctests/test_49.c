@@ -0,0 +1,82 @@
+#include "tester.h"
+#include "clock.h"
+#include "sched.h"
+
+// ====================================================================
+// TEST_49
+// Summary: WAKEPREEMPT: a woken process preempts a CPU-bound one of
+// worse priority, or of the same one if it slept long enough, even
+// when the wakeup comes from the clock tick
+// ====================================================================
+
+char *test_name = "TEST_49";
+
+#define MS 1000000ULL
+#define NSLEEP 50
+#define NTICKSLEEP 20
+
+static uint64 now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Sleep 1ms NSLEEP times while the spinner has the CPU. Woken
+// only at the spinner's next tick or slice end, that would take
+// several times longer.
+static void sleeps(char *what) {
+    struct timespec ts;
+    int i;
+
+    uint64 t0 = now();
+    for (i = 0; i < NSLEEP; i++) {
+        ts.tv_sec = 0;
+        ts.tv_nsec = MS;
+        if (nanosleep(&ts) != SUCCESS) {
+            printerr("nanosleep() failed\n");
+            failed();
+        }
+    }
+    uint64 t = now() - t0;
+    if (t > 4 * NSLEEP * MS) {
+        printerr("%s: %d x nanosleep(1ms) took %d us\n", what, NSLEEP, (uint)(t >> 10));
+        failed();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    int spinner = fork();
+    if (spinner == 0)
+        for (;;)
+            ;
+    sleep(10);  // long enough for it to sink to the bottom level
+
+    // better priority: preempts
+    sleeps("above the spinner");
+
+    // same priority, but slept far longer than the granularity
+    if (setpriority(spinner, NMLFQ - 1) != SUCCESS ||
+        setpriority(getpid(), NMLFQ - 1) != SUCCESS) {
+        printerr("setpriority() failed\n");
+        failed();
+    }
+    sleeps("level with the spinner");
+
+    // and woken by the clock tick itself, which must not
+    // leave the spinner the rest of its slice
+    int t0 = uptime();
+    for (int i = 0; i < NTICKSLEEP; i++)
+        sleep(1);
+    int t = uptime() - t0;
+    if (t > NTICKSLEEP * 3 / 2) {
+        printerr("%d x sleep(1) took %d ticks\n", NTICKSLEEP, t);
+        failed();
+    }
+
+    setpriority(getpid(), -1);
+    kill(spinner);
+    wait();
+    success();
+}
@@ -0,0 +1,90 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_50
+// Summary: SLEEPQ: a wakeup wakes only the sleepers on its channel,
+// whichever sleep queue they hash to, and kill() wakes a sleeper
+// ====================================================================
+
+char *test_name = "TEST_50";
+
+#define NKIDS 10  // each keeps a pipe open here; NOFILE is 16
+#define NREADERS 4
+
+int kid[NKIDS][2];
+int pid[NKIDS];
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    int done[2], i, k;
+    char c;
+
+    // each child sleeps reading its own pipe, then reports
+    pipe(done);
+    for (i = 0; i < NKIDS; i++) {
+        pipe(kid[i]);
+        if ((pid[i] = fork()) == 0) {
+            close(kid[i][1]);
+            if (read(kid[i][0], &c, 1) != 1)
+                exit();
+            c = i;
+            write(done[1], &c, 1);
+            exit();
+        }
+        close(kid[i][0]);
+    }
+    sleep(5);  // let them all go to sleep
+
+    // wake them out of order, one at a time; one is killed instead
+    int killed = NKIDS / 2;
+    for (i = 0; i < NKIDS; i++) {
+        k = i * 7 % NKIDS;
+        if (k == killed) {
+            kill(pid[k]);
+            if (wait() != pid[k]) {
+                printerr("killed child %d did not exit\n", k);
+                failed();
+            }
+            continue;
+        }
+        write(kid[k][1], "x", 1);
+        if (read(done[0], &c, 1) != 1 || c != k) {
+            printerr("woke child %d, but child %d ran\n", k, c);
+            failed();
+        }
+    }
+    for (i = 0; i < NKIDS; i++) {
+        close(kid[i][1]);
+        if (i != killed && wait() < 0) {
+            printerr("lost a child\n");
+            failed();
+        }
+    }
+
+    // several sleepers on one channel: each byte wakes one reader
+    int p[2];
+    pipe(p);
+    for (i = 0; i < NREADERS; i++) {
+        if (fork() == 0) {
+            close(p[1]);
+            if (read(p[0], &c, 1) == 1)
+                write(done[1], &c, 1);
+            exit();
+        }
+    }
+    close(p[0]);
+    sleep(5);
+    for (i = 0; i < NREADERS; i++) {
+        c = 'a' + i;
+        write(p[1], &c, 1);
+        if (read(done[0], &c, 1) != 1 || c != 'a' + i) {
+            printerr("reader %d got %c\n", i, c);
+            failed();
+        }
+    }
+    close(p[1]);
+    for (i = 0; i < NREADERS; i++)
+        wait();
+    success();
+}
@@ -0,0 +1,113 @@
+#include "tester.h"
+#include "param.h"
+#include "memstat.h"
+#include "sched.h"
+
+// ====================================================================
+// TEST_51
+// Summary: PERCPU: each CPU's own data is found from that CPU, both
+// for one process moved around and for many running at once
+// ====================================================================
+
+char *test_name = "TEST_51";
+
+#define NPG 32
+
+struct faulthist h0[NCPU], h1[NCPU];
+
+uint zerofills(struct faulthist *h) {
+    uint n = 0;
+    for (int b = 0; b < NFAULTBIN; b++)
+        n += h->count[FK_ZERO][b];
+    return n;
+}
+
+void get_hists(int ncpu, struct faulthist *h) {
+    for (int c = 0; c < ncpu; c++)
+        if (getfaulthist(c, &h[c]) != SUCCESS) {
+            printerr("getfaulthist(%d) failed\n", c);
+            failed();
+        }
+}
+
+// Zero-fill NPG pages of a fresh map; the faults count on this CPU.
+int touch(void) {
+    uint addr = MMAPBASE;
+    if (wmap(addr, NPG * PGSIZE, MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS, -1) != addr)
+        return 0;
+    for (int i = 0; i < NPG; i++)
+        ((char *)addr)[i * PGSIZE] = i;
+    return wunmap(addr) == SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    struct schedstat st;
+    struct cpustat cs;
+    int pid = getpid(), ncpu, c;
+
+    for (ncpu = 0; ncpu < NCPU && getcpustat(ncpu, &cs) == SUCCESS; ncpu++)
+        ;
+    if (ncpu < 4) {
+        printerr("%d CPUs; run with CPUS=4\n", ncpu);
+        failed();
+    }
+
+    // one process visits each CPU in turn
+    for (c = 0; c < ncpu; c++) {
+        setaffinity(pid, 1 << c);
+        sleep(2);
+        getschedstats(pid, &st);
+        if (st.cpu != c) {
+            printerr("pinned to CPU %d, ran on %d\n", c, st.cpu);
+            failed();
+        }
+        get_hists(ncpu, h0);
+        if (!touch()) {
+            printerr("wmap() failed\n");
+            failed();
+        }
+        get_hists(ncpu, h1);
+        if (zerofills(&h1[c]) - zerofills(&h0[c]) < NPG) {
+            printerr("CPU %d counted %d of %d faults\n", c,
+                     zerofills(&h1[c]) - zerofills(&h0[c]), NPG);
+            failed();
+        }
+    }
+    setaffinity(pid, (1 << ncpu) - 1);
+
+    // one child per CPU, all at once
+    int p[2];
+    pipe(p);
+    get_hists(ncpu, h0);
+    for (c = 0; c < ncpu; c++) {
+        if (fork() == 0) {
+            setaffinity(getpid(), 1 << c);
+            sleep(1);
+            char ok = 1;
+            for (int i = 0; i < 4; i++)
+                ok &= touch();
+            getschedstats(getpid(), &st);
+            ok &= st.cpu == c;
+            write(p[1], &ok, 1);
+            exit();
+        }
+    }
+    for (c = 0; c < ncpu; c++) {
+        char ok;
+        if (read(p[0], &ok, 1) != 1 || !ok) {
+            printerr("a child failed on its CPU\n");
+            failed();
+        }
+        wait();
+    }
+    get_hists(ncpu, h1);
+    for (c = 0; c < ncpu; c++)
+        if (zerofills(&h1[c]) - zerofills(&h0[c]) < 4 * NPG) {
+            printerr("CPU %d counted %d of %d faults\n", c,
+                     zerofills(&h1[c]) - zerofills(&h0[c]), 4 * NPG);
+            failed();
+        }
+    success();
+}
@@ -0,0 +1,70 @@
+#include "tester.h"
+#include "clock.h"
+
+// ====================================================================
+// TEST_52
+// Summary: PROTNONE: the kernel won't copy to or from a PROT_NONE
+// page, even one that is present
+// ====================================================================
+
+char *test_name = "TEST_52";
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    uint addr = MMAPBASE;
+    char *arr = (char *)addr;
+    int p[2];
+
+    if (wmap(addr, PGSIZE, MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS, -1) != addr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    strcpy(arr, "secret");
+    if (wprotect(addr, PGSIZE, PROT_NONE) != SUCCESS) {
+        printerr("wprotect(PROT_NONE) failed\n");
+        failed();
+    }
+    va_exists(addr, TRUE);
+
+    pipe(p);
+    if (write(p[1], arr, 6) != FAILED) {
+        printerr("wrote a PROT_NONE page into a pipe\n");
+        failed();
+    }
+    if (write(1, arr, 6) != FAILED) {
+        printerr("wrote a PROT_NONE page to the console\n");
+        failed();
+    }
+    int fd = open("test52.txt", O_CREATE | O_RDWR);
+    if (write(fd, arr, 6) != FAILED) {
+        printerr("wrote a PROT_NONE page to a file\n");
+        failed();
+    }
+    close(fd);
+    write(p[1], "x", 1);
+    if (read(p[0], arr, 1) != FAILED) {
+        printerr("read from a pipe into a PROT_NONE page\n");
+        failed();
+    }
+    if (nanosleep((struct timespec *)arr) != FAILED) {
+        printerr("nanosleep() read a PROT_NONE page\n");
+        failed();
+    }
+
+    close(p[0]);
+    close(p[1]);
+
+    // readable again: the contents were kept
+    char c;
+    pipe(p);
+    if (wprotect(addr, PGSIZE, PROT_READ) != SUCCESS || write(p[1], arr, 6) != 6 ||
+        read(p[0], &c, 1) != 1 || c != 's') {
+        printerr("PROT_READ page was not copied\n");
+        failed();
+    }
+    close(p[0]);
+    close(p[1]);
+    wunmap(addr);
+    success();
+}
@@ -0,0 +1,110 @@
+#include "tester.h"
+
+// ====================================================================
+// TEST_53
+// Summary: USERFAULT: only a map's handler sees and fills its faults;
+// wfhandler() hands the map to another process
+// ====================================================================
+
+char *test_name = "TEST_53";
+
+char page[PGSIZE];
+
+// Fault on the first byte of the map at addr and report it.
+int faulter(uint addr, int *result) {
+    int pid = fork();
+    if (pid == 0) {
+        *result = *(char *)addr;
+        exit();
+    }
+    return pid;
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    uint uaddr = MMAPBASE;
+    uint vaddr = MMAPBASE + PGSIZE;
+    uint raddr = MMAPBASE + 16 * PGSIZE;
+    int anon = MAP_FIXED | MAP_SHARED | MAP_ANONYMOUS;
+    struct wfaultinfo info;
+    int p[2];
+    char c;
+
+    if (wmap(uaddr, PGSIZE, anon | MAP_USERFAULT, -1) != uaddr ||
+        wmap(vaddr, PGSIZE, anon | MAP_USERFAULT, -1) != vaddr ||
+        wmap(raddr, PGSIZE, anon, -1) != raddr) {
+        printerr("wmap() failed\n");
+        failed();
+    }
+    volatile int *result = (int *)raddr;
+    result[0] = result[1] = 0;
+
+    // a process handling no map never sees our faults
+    pipe(p);
+    int thief = fork();
+    if (thief == 0) {
+        close(p[0]);
+        if (wfault(&info) == SUCCESS)
+            write(p[1], "s", 1);
+        exit();
+    }
+    close(p[1]);
+    int pid = faulter(uaddr, (int *)&result[0]);
+    if (wfault(&info) != SUCCESS || info.pid != pid || info.addr != uaddr) {
+        printerr("wfault() did not report our own map's fault\n");
+        failed();
+    }
+
+    // nor can it fill them; if it could, ours would find no fault
+    if (fork() == 0) {
+        memset(page, 'X', PGSIZE);
+        wfill(pid, uaddr, page);
+        exit();
+    }
+    wait();
+    memset(page, 'P', PGSIZE);
+    if (wfill(pid, uaddr, page) != SUCCESS) {
+        printerr("wfill() by the handler failed\n");
+        failed();
+    }
+    while (wait() != pid)
+        ;
+    if (result[0] != 'P') {
+        printerr("child saw %c, expected P\n", result[0]);
+        failed();
+    }
+    kill(thief);
+    wait();
+    if (read(p[0], &c, 1) != 0) {
+        printerr("wfault() reported another process's fault\n");
+        failed();
+    }
+    close(p[0]);
+
+    // hand the second map to a child, which handles it
+    if (wfhandler(vaddr, 12345) != FAILED || wfhandler(raddr, getpid()) != FAILED) {
+        printerr("wfhandler() accepted a bad pid or map\n");
+        failed();
+    }
+    int handler = fork();
+    if (handler == 0) {
+        if (wfault(&info) == SUCCESS && info.addr == vaddr) {
+            memset(page, 'H', PGSIZE);
+            wfill(info.pid, vaddr, page);
+        }
+        exit();
+    }
+    if (wfhandler(vaddr, handler) != SUCCESS) {
+        printerr("wfhandler() failed\n");
+        failed();
+    }
+    faulter(vaddr, (int *)&result[1]);
+    wait();
+    wait();
+    if (result[1] != 'H') {
+        printerr("child saw %c, expected H\n", result[1]);
+        failed();
+    }
+    success();
+}
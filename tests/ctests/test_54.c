@@ -0,0 +1,97 @@
+#include "tester.h"
+#include "param.h"
+#include "sched.h"
+
+// ====================================================================
+// TEST_54
+// Summary: RUNQ: fork queues the child on the parent's CPU, and an
+// idle CPU steals work from a busy one
+// ====================================================================
+
+char *test_name = "TEST_54";
+
+struct schedstat get_stats(int pid) {
+    struct schedstat st;
+    if (getschedstats(pid, &st) != SUCCESS) {
+        printerr("getschedstats(%d) failed\n", pid);
+        failed();
+    }
+    return st;
+}
+
+// A CPU-bound child that may run anywhere. It starts on the
+// parent's CPU, since it inherits the parent's affinity.
+int spinner(void) {
+    int pid = fork();
+    if (pid == 0) {
+        setaffinity(getpid(), 0x3);
+        for (;;)
+            ;
+    }
+    return pid;
+}
+
+int main(int argc, char *argv[]) {
+    printf(1, "\n\n%s\n", test_name);
+
+    int pid = getpid(), i;
+    struct cpustat cs;
+
+    if (getcpustat(1, &cs) != SUCCESS) {
+        printerr("1 CPU; run with CPUS=2\n");
+        failed();
+    }
+
+    // two spinners queued on CPU 0: CPU 1 takes one of them
+    setaffinity(pid, 0x1);
+    sleep(2);
+    int a = spinner(), b = spinner();
+    struct schedstat sa, sb;
+    for (i = 0; i < 100; i++) {
+        sa = get_stats(a);
+        sb = get_stats(b);
+        if (sa.cpu == 1 || sb.cpu == 1)
+            break;
+        sleep(1);
+    }
+    if (sa.cpu != 1 && sb.cpu != 1) {
+        printerr("neither spinner was stolen onto CPU 1\n");
+        failed();
+    }
+    if ((sa.cpu == 1 ? sa : sb).migrations == 0) {
+        printerr("stolen spinner never ran on CPU 0\n");
+        failed();
+    }
+    kill(a);
+    kill(b);
+    wait();
+    wait();
+
+    // CPU 0 busy with a spinner of the same priority: a child
+    // forked on CPU 1 waits there for it, rather than elsewhere
+    int s = fork();
+    if (s == 0)
+        for (;;)
+            ;
+    setpriority(s, 0);
+    setaffinity(pid, 0x2);
+    sleep(2);
+    setaffinity(pid, 0x3);
+    int p[2];
+    pipe(p);
+    if (fork() == 0) {
+        struct schedstat st = get_stats(getpid());
+        char ok = st.cpu == 1 && st.migrations == 0;
+        write(p[1], &ok, 1);
+        exit();
+    }
+    char ok;
+    if (read(p[0], &ok, 1) != 1 || !ok) {
+        printerr("child forked on CPU 1 did not run there\n");
+        failed();
+    }
+    wait();
+    kill(s);
+    wait();
+    success();
+}
@@ -8,6 +8,7 @@
 #include "stat.h"
 
 #include "wmap.h"
+#include "swap.h"
 
 // Test Helpers
 #define MMAPBASE 0x60000000
@@ -258,4 +259,37 @@ int open_file(char *filename, int filelength) {
     return fd;
 }
 
+// Fork a child that takes all but about leave pages of free memory
+// and sleeps holding them, where reclaim can't take them back, so a
+// test runs out of memory without having to fill all of it itself.
+// Returns a file descriptor; close it and wait() to let them go.
+int hold_memory(int leave) {
+    struct swapstat st;
+    int go[2], ready[2], n;
+    char c;
+
+    if (pipe(go) < 0 || pipe(ready) < 0) {
+        printerr("pipe() failed\n");
+        failed();
+    }
+    if (fork() == 0) {
+        close(go[1]);
+        getswapstat(&st);
+        // each 1024 pages also take a page table
+        n = st.freepages - leave - st.freepages / 1024 - 1;
+        c = n <= 0 || sbrk(n * PGSIZE) != (char *)-1;
+        write(ready[1], &c, 1);
+        read(go[0], &c, 1);
+        exit();
+    }
+    close(go[0]);
+    if (read(ready[0], &c, 1) != 1 || !c) {
+        printerr("could not take memory to hold\n");
+        failed();
+    }
+    close(ready[0]);
+    close(ready[1]);
+    return go[1];
+}
+
 #endif // TESTER_H
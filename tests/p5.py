@@ -279,6 +279,325 @@ class test25(Xv6Test):
     failure_pattern = "Segmentation Fault"
 
 
+class test26(Xv6Test):
+    name = "test_26"
+    description = "USERFAULT: child faults on a MAP_USERFAULT map, parent fills the page"
+    tester = "ctests/test_26.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test27(Xv6Test):
+    name = "test_27"
+    description = "WPROTECT: read-only middle page splits the map, RW again joins it"
+    tester = "ctests/test_27.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test28(Xv6Test):
+    name = "test_28"
+    description = "read() and write() on map pages that are not loaded yet"
+    tester = "ctests/test_28.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test29(Xv6Test):
+    name = "test_29"
+    description = "read() into an unmapped or read-only map address fails cleanly"
+    tester = "ctests/test_29.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test30(Xv6Test):
+    name = "test_30"
+    description = "GETMEMSTAT: faults and rss follow map faults, COW and unmap"
+    tester = "ctests/test_30.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test31(Xv6Test):
+    name = "test_31"
+    description = "PAGEMAP: residency of a map, and sharing after fork"
+    tester = "ctests/test_31.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test32(Xv6Test):
+    name = "test_32"
+    description = "SPAWN: start a program with its output redirected"
+    tester = "ctests/test_32.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test33(Xv6Test):
+    name = "test_33"
+    description = "MLFQ: setpriority pins a level, getschedstats reports it"
+    tester = "ctests/test_33.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test34(Xv6Test):
+    name = "test_34"
+    description = "AFFINITY: setaffinity/getaffinity, inherited by fork, moves a running process"
+    tester = "ctests/test_34.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test35(Xv6Test):
+    name = "test_35"
+    description = "TIMERS: concurrent sleepers wake after their own deadlines"
+    tester = "ctests/test_35.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test36(Xv6Test):
+    name = "test_36"
+    description = "CLOCK: clock_gettime is monotonic, nanosleep is sub-tick"
+    tester = "ctests/test_36.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test37(Xv6Test):
+    name = "test_37"
+    description = "IDLE: idle CPUs halt with their tick stopped, a busy one keeps ticking"
+    tester = "ctests/test_37.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test38(Xv6Test):
+    name = "test_38"
+    description = "LOCKSTAT: per-lock counts while on, frozen while off"
+    tester = "ctests/test_38.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test39(Xv6Test):
+    name = "test_39"
+    description = "USERFAULT: a fill goes only to the fault it names"
+    tester = "ctests/test_39.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test40(Xv6Test):
+    name = "test_40"
+    description = "read() into a map of the same file, big unaligned read/write"
+    tester = "ctests/test_40.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test41(Xv6Test):
+    name = "test_41"
+    description = "FORK: shared page tables isolate writes down to a grandchild"
+    tester = "ctests/test_41.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test42(Xv6Test):
+    name = "test_42"
+    description = "SWAP: pages swapped to disk under pressure come back intact across fork"
+    tester = "ctests/test_42.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test43(Xv6Test):
+    name = "test_43"
+    description = "RECLAIM: file map pages dropped under pressure, dirty ones written back"
+    tester = "ctests/test_43.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test44(Xv6Test):
+    name = "test_44"
+    description = "KSM: identical pages merge, a write unmerges only the writer"
+    tester = "ctests/test_44.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test45(Xv6Test):
+    name = "test_45"
+    description = "ZSWAP: compressible pages round trip through the pool across fork"
+    tester = "ctests/test_45.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test46(Xv6Test):
+    name = "test_46"
+    description = "FAULTHIST: each kind of fault lands in its own histogram"
+    tester = "ctests/test_46.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test47(Xv6Test):
+    name = "test_47"
+    description = "REAPER: exited memory comes back, freed in batches"
+    tester = "ctests/test_47.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test48(Xv6Test):
+    name = "test_48"
+    description = "KTHREAD: kernel threads stay put, MLFQ demotes and boosts"
+    tester = "ctests/test_48.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test49(Xv6Test):
+    name = "test_49"
+    description = "WAKEPREEMPT: woken processes preempt a CPU-bound one"
+    tester = "ctests/test_49.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test50(Xv6Test):
+    name = "test_50"
+    description = "SLEEPQ: wakeups reach only their own channel's sleepers"
+    tester = "ctests/test_50.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test51(Xv6Test):
+    name = "test_51"
+    description = "PERCPU: each CPU finds its own per-CPU data"
+    tester = "ctests/test_51.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=4"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test52(Xv6Test):
+    name = "test_52"
+    description = "PROTNONE: the kernel won't copy a PROT_NONE page"
+    tester = "ctests/test_52.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test53(Xv6Test):
+    name = "test_53"
+    description = "USERFAULT: only a map's handler sees and fills its faults"
+    tester = "ctests/test_53.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=1"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
+class test54(Xv6Test):
+    name = "test_54"
+    description = "RUNQ: fork queues locally, idle CPUs steal"
+    tester = "ctests/test_54.c"
+    header = "ctests/tester.h"
+    make_qemu_args = "CPUS=2"
+    point_value = 1
+    success_pattern = "PASSED"
+    failure_pattern = "Segmentation Fault"
+
+
 from testing.runtests import main
 
 main(
@@ -309,6 +628,35 @@ main(
         test23,
         test24,
         test25,
+        test26,
+        test27,
+        test28,
+        test29,
+        test30,
+        test31,
+        test32,
+        test33,
+        test34,
+        test35,
+        test36,
+        test37,
+        test38,
+        test39,
+        test40,
+        test41,
+        test42,
+        test43,
+        test44,
+        test45,
+        test46,
+        test47,
+        test48,
+        test49,
+        test50,
+        test51,
+        test52,
+        test53,
+        test54,
     ],
     # Add your test groups here
     # End of test groups
@@ -0,0 +1,10 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+// for `clock_gettime` and `nanosleep`
+#define CLOCK_MONOTONIC 1  // Time since boot
+
+struct timespec {
+    uint tv_sec;   // Seconds
+    uint tv_nsec;  // and nanoseconds, below 1000000000
+};
+#endif
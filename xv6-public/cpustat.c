@@ -0,0 +1,23 @@
+// Print each CPU's idle residency: how much of the time since
+// boot it spent halted with nothing to run.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "sched.h"
+
+int
+main(void)
+{
+  struct cpustat st;
+  uint pct;
+  int cpu;
+
+  for(cpu = 0; getcpustat(cpu, &st) == 0; cpu++){
+    pct = st.upms >= 100 ? st.idlems / (st.upms / 100) : 0;
+    printf(1, "cpu%d: idle %d of %d ms (%d%%), %d halts, %d ticks%s\n",
+           cpu, st.idlems, st.upms, pct, st.halts, st.ticks,
+           st.nohz ? ", tick stopped" : "");
+  }
+  exit();
+}
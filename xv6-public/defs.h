@@ -9,6 +9,15 @@ struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct swapstat;
+struct ksmstat;
+struct faulthist;
+struct textseg;
+struct image;
+struct spawnfa;
+struct timer;
+struct hrtimer;
+struct lockstat;
 
 typedef uint pte_t;
 
@@ -26,6 +35,9 @@ void            panic(char*) __attribute__((noreturn));
 
 // exec.c
 int             exec(char*, char**);
+int             loadimage(char*, char**, struct image*);
+struct textseg* findtext(struct proc*, uint);
+int             textfault(struct proc*, uint);
 
 // file.c
 struct file*    filealloc(void);
@@ -33,8 +45,10 @@ void            fileclose(struct file*);
 struct file*    filedup(struct file*);
 void            fileinit(void);
 int             fileread(struct file*, char*, int n);
+int             filereaduser(struct file*, uint, int n);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
+int             filewriteuser(struct file*, uint, int n);
 
 // fs.c
 void            readsb(int dev, struct superblock *sb);
@@ -52,8 +66,10 @@ int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
 struct inode*   nameiparent(char*, char*);
 int             readi(struct inode*, char*, uint, uint);
+int             readiuser(struct inode*, uint, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
+int             writeiuser(struct inode*, uint, uint, uint);
 
 // ide.c
 void            ideinit(void);
@@ -68,6 +84,8 @@ void            ioapicinit(void);
 // kalloc.c
 char*           kalloc(void);
 void            kfree(char*);
+void            kfreen(char**, int);
+uint            kfreecount(void);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
 void            inc_ref_count(uint pa); 
@@ -76,13 +94,28 @@ void            decrement_ref_count(uint pa);
 // kbd.c
 void            kbdintr(void);
 
+// ksm.c
+int             getksmstat(struct ksmstat*);
+void            ksminit(void);
+void            ksmpage(struct proc*, uint, pte_t*);
+void            ksmpass(void);
+int             ksmunmerge(pde_t*, uint, uint);
+
 // lapic.c
 void            cmostime(struct rtcdate *r);
 int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
+void            lapicipi(uchar, int);
 void            lapicstartap(uchar, uint);
+void            lapicarm(uint64);
+int             lapictimer(void);
+void            lapicnohz(int);
+uint64          cyclestons(uint64);
+uint64          nsuptime(void);
+uint64          nstocycles(uint64);
+uint64          udiv64(uint64, uint, uint*);
 void            microdelay(int);
 
 // log.c
@@ -112,14 +145,21 @@ void            exit(void);
 int             fork(void);
 int             growproc(int);
 int             kill(int);
+void            ksmscan(int);
+struct proc*    kthread_create(char*, void(*)(void*), void*, int);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
+void            mlfqboost(void);
 void            pinit(void);
 void            procdump(void);
+int             reclaim(void);
+int             reclaimable(struct proc*);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
+void            schedtick(void);
 void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
+int             spawn(char*, char**, struct spawnfa*, int);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
@@ -128,6 +168,10 @@ void            yield(void);
 // swtch.S
 void            swtch(struct context**, struct context*);
 
+// usercopy.S
+int             usercopy(void*, void*, uint);
+int             userstrlen(char*, uint);
+
 // spinlock.c
 void            acquire(struct spinlock*);
 void            getcallerpcs(void*, uint*);
@@ -136,6 +180,8 @@ void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
+void            lockstatctl(int);
+int             getlockstat(int, struct lockstat*);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
@@ -155,16 +201,48 @@ char*           strncpy(char*, const char*, int);
 // syscall.c
 int             argint(int, int*);
 int             argptr(int, char**, int);
+int             argcptr(int, char**, int);
 int             argstr(int, char**);
 int             fetchint(uint, int*);
 int             fetchstr(uint, char**);
 void            syscall(void);
 
+// swap.c
+void            swapinit(int);
+int             swapalloc(void);
+void            swapassign(int, uint);
+void            swapcancel(int);
+void            swapwrite(int);
+int             swapin(pde_t*, uint);
+void            swapfree(pte_t);
+void            swapdup(pte_t);
+int             getswapstat(struct swapstat*);
+uint            average(uint64, uint);
+
+// zswap.c
+void            zswapinit(void);
+int             zput(char*, int, int*, uint*);
+void            zget(uint, int, char*);
+void            zdrop(uint, int);
+void            zstat(struct swapstat*);
+
 // timer.c
 void            timerinit(void);
+void            settimer(struct timer*, uint, void(*)(void*), void*);
+int             deltimer(struct timer*);
+void            runtimers(uint);
+int             ticksleep(uint);
+void            sethrtimer(struct hrtimer*, uint64, void(*)(void*), void*);
+int             delhrtimer(struct hrtimer*);
+void            runhrtimers(void);
+void            hrarm(void);
+int             nssleep(uint64);
 
 // trap.c
 void            idtinit(void);
+int             pagefault(struct proc*, uint, int);
+int             prefault(struct proc*, uint, uint, int);
+int             getfaulthist(int, struct faulthist*);
 extern uint     ticks;
 void            tvinit(void);
 extern struct spinlock tickslock;
@@ -182,15 +260,27 @@ char*           uva2ka(pde_t*, char*);
 int             allocuvm(pde_t*, uint, uint);
 int             deallocuvm(pde_t*, uint, uint);
 void            freevm(pde_t*);
+void            freevmlater(pde_t*);
+void            reapinit(void);
+int             reapwait(void);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint, int);
 pde_t*          copyuvm(pde_t*, uint);
+int             ptshared(pde_t*, uint);
+int             unsharept(pde_t*, uint);
+int             droppt(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
+int             copy_to_user(uint, void*, uint);
+int             copy_from_user(void*, uint, uint);
+int             copy_to_user_nofault(uint, void*, uint);
+int             copy_from_user_nofault(void*, uint, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
 int             perform_mapping(pde_t *pgdir, void *va, uint size, uint pa, int perm);
 pte_t*          get_pte(pde_t *pgdir, void *va);
+int             ptpages(pde_t*);
+int             resident(pde_t*, uint, uint);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
@@ -7,8 +7,11 @@
 #include "x86.h"
 #include "elf.h"
 
+// Build a new user image for the program at path, with argv
+// pushed on its stack, in a fresh page directory. Nothing about
+// the calling process changes. Returns 0 and fills in *im, or -1.
 int
-exec(char *path, char **argv)
+loadimage(char *path, char **argv, struct image *im)
 {
   char *s, *last;
   int i, off;
@@ -16,8 +19,9 @@ exec(char *path, char **argv)
   struct elfhdr elf;
   struct inode *ip;
   struct proghdr ph;
-  pde_t *pgdir, *oldpgdir;
-  struct proc *curproc = myproc();
+  pde_t *pgdir;
+  struct inode *exe;
+  int ntext;
 
   begin_op();
 
@@ -28,6 +32,8 @@ exec(char *path, char **argv)
   }
   ilock(ip);
   pgdir = 0;
+  exe = 0;
+  ntext = 0;
 
   // Check ELF header
   if(readi(ip, (char*)&elf, 0, sizeof(elf)) != sizeof(elf))
@@ -55,7 +61,14 @@ exec(char *path, char **argv)
       goto bad;
     if(loaduvm(pgdir, (char*)ph.vaddr, ip, ph.off, ph.filesz, ph.flags) < 0)
       goto bad;
+    if(!(ph.flags & ELF_PROG_FLAG_WRITE) && ntext < NTEXTSEG){
+      im->text[ntext].va = ph.vaddr;
+      im->text[ntext].off = ph.off;
+      im->text[ntext].filesz = ph.filesz;
+      ntext++;
+    }
   }
+  exe = idup(ip);
   iunlockput(ip);
   end_op();
   ip = 0;
@@ -91,16 +104,14 @@ exec(char *path, char **argv)
   for(last=s=path; *s; s++)
     if(*s == '/')
       last = s+1;
-  safestrcpy(curproc->name, last, sizeof(curproc->name));
+  safestrcpy(im->name, last, sizeof(im->name));
 
-  // Commit to the user image.
-  oldpgdir = curproc->pgdir;
-  curproc->pgdir = pgdir;
-  curproc->sz = sz;
-  curproc->tf->eip = elf.entry;  // main
-  curproc->tf->esp = sp;
-  switchuvm(curproc);
-  freevm(oldpgdir);
+  im->pgdir = pgdir;
+  im->sz = sz;
+  im->entry = elf.entry;
+  im->sp = sp;
+  im->exe = exe;
+  im->ntext = ntext;
   return 0;
 
  bad:
@@ -110,5 +121,94 @@ exec(char *path, char **argv)
     iunlockput(ip);
     end_op();
   }
+  if(exe){
+    begin_op();
+    iput(exe);
+    end_op();
+  }
   return -1;
 }
+
+int
+exec(char *path, char **argv)
+{
+  struct image im;
+  pde_t *oldpgdir;
+  struct inode *oldexe;
+  int i;
+  struct proc *curproc = myproc();
+
+  if(loadimage(path, argv, &im) < 0)
+    return -1;
+  safestrcpy(curproc->name, im.name, sizeof(curproc->name));
+
+  // Commit to the user image.
+  oldpgdir = curproc->pgdir;
+  oldexe = curproc->exe;
+  curproc->pgdir = im.pgdir;
+  curproc->sz = im.sz;
+  curproc->exe = im.exe;
+  memmove(curproc->text, im.text, sizeof(im.text));
+  curproc->ntext = im.ntext;
+  // Every page of the new image is present; maps start out empty.
+  curproc->mstat.rss = im.sz / PGSIZE;
+  for(i = 0; i < curproc->mmap_count; i++)
+    curproc->mmap_regions[i].nloaded = 0;
+  curproc->tf->eip = im.entry;  // main
+  curproc->tf->esp = im.sp;
+  switchuvm(curproc);
+  freevm(oldpgdir);
+  if(oldexe){
+    begin_op();
+    iput(oldexe);
+    end_op();
+  }
+  return 0;
+}
+
+// Find the read-only segment of p's program holding the page at va.
+struct textseg*
+findtext(struct proc *p, uint va)
+{
+  struct textseg *t;
+
+  if(p->exe == 0)
+    return 0;
+  for(t = p->text; t < &p->text[p->ntext]; t++)
+    if(va >= t->va && va < t->va + PGROUNDUP(t->filesz))
+      return t;
+  return 0;
+}
+
+// Read back a page of program text that reclaim() dropped.
+// Returns 0 on success, -1 if va is not program text.
+int
+textfault(struct proc *p, uint va)
+{
+  struct textseg *t;
+  char *mem;
+  uint off, n;
+
+  va = PGROUNDDOWN(va);
+  if((t = findtext(p, va)) == 0)
+    return -1;
+  if((mem = kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+  off = va - t->va;
+  n = t->filesz - off;
+  if(n > PGSIZE)
+    n = PGSIZE;
+  ilock(p->exe);
+  if(readi(p->exe, mem, t->off + off, n) != n){
+    iunlock(p->exe);
+    kfree(mem);
+    return -1;
+  }
+  iunlock(p->exe);
+  if(perform_mapping(p->pgdir, (void*)va, PGSIZE, V2P(mem), PTE_U) < 0){
+    kfree(mem);
+    return -1;
+  }
+  return 0;
+}
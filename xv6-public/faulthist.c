@@ -0,0 +1,48 @@
+// Print page fault latency histograms, summed over all CPUs
+// or, with -c N, for CPU N.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "memstat.h"
+
+char *kinds[NFAULTKIND] = {
+[FK_ZERO]   "zero-fill",
+[FK_FILE]   "file read",
+[FK_COW]    "cow copy",
+[FK_SWAP]   "swap-in",
+[FK_UFAULT] "userfault",
+};
+
+int
+main(int argc, char *argv[])
+{
+  struct faulthist h;
+  int cpu, k, b, n;
+
+  cpu = -1;
+  if(argc == 3 && strcmp(argv[1], "-c") == 0)
+    cpu = atoi(argv[2]);
+  else if(argc != 1){
+    printf(2, "usage: faulthist [-c cpu]\n");
+    exit();
+  }
+  if(getfaulthist(cpu, &h) < 0){
+    printf(2, "faulthist: failed\n");
+    exit();
+  }
+  for(k = 0; k < NFAULTKIND; k++){
+    n = 0;
+    for(b = 0; b < NFAULTBIN; b++)
+      n += h.count[k][b];
+    printf(1, "%s: %d faults\n", kinds[k], n);
+    if(n == 0)
+      continue;
+    for(b = 0; b < NFAULTBIN - 1; b++)
+      if(h.count[k][b])
+        printf(1, "  < 2^%d cycles\t%d\n", b + 1, h.count[k][b]);
+    if(h.count[k][b])
+      printf(1, "  >= 2^%d cycles\t%d\n", b, h.count[k][b]);
+  }
+  exit();
+}
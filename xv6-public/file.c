@@ -5,10 +5,12 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "mmu.h"
 #include "fs.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "stat.h"
 
 struct devsw devsw[NDEV];
 struct {
@@ -155,3 +157,66 @@ filewrite(struct file *f, char *addr, int n)
   panic("filewrite");
 }
 
+// Most bytes a single begin_op()/end_op() may write: the
+// i-node, an indirect block, allocation blocks, and 2 blocks
+// of slop for non-aligned writes.
+#define MAXWRITE (((MAXOPBLOCKS-1-1-2) / 2) * 512)
+
+// Read from inode file f straight to user address addr, with no
+// kernel buffer in between. Each piece of the user range is faulted
+// in before the inode is locked, since a fault on a map of this
+// file would need that lock; a page taken away again in between
+// just ends the piece early, and it is faulted in once more.
+// Returns the bytes read, 0 at the end of the file, or -1
+// if the user range is bad before any could be.
+int
+filereaduser(struct file *f, uint addr, int n)
+{
+  struct inode *ip = f->ip;
+  int tot, m, r, eof;
+
+  if(f->readable == 0 || f->type != FD_INODE || ip->type == T_DEV)
+    return -1;
+  for(tot = 0; tot < n; tot += r){
+    m = n - tot < PGSIZE ? n - tot : PGSIZE;
+    if(prefault(myproc(), addr + tot, m, 1) < 0)
+      return tot > 0 ? tot : -1;
+    ilock(ip);
+    if((r = readiuser(ip, addr + tot, f->off, m)) > 0)
+      f->off += r;
+    eof = f->off >= ip->size;
+    iunlock(ip);
+    if(r < 0)
+      return tot > 0 ? tot : -1;
+    if(eof)
+      return tot + r;
+  }
+  return tot;
+}
+
+// Write to inode file f straight from user address addr;
+// see filereaduser.
+int
+filewriteuser(struct file *f, uint addr, int n)
+{
+  struct inode *ip = f->ip;
+  int tot, m, r;
+
+  if(f->writable == 0 || f->type != FD_INODE || ip->type == T_DEV)
+    return -1;
+  for(tot = 0; tot < n; tot += r){
+    m = n - tot < MAXWRITE ? n - tot : MAXWRITE;
+    if(prefault(myproc(), addr + tot, m, 0) < 0)
+      break;
+    begin_op();
+    ilock(ip);
+    if((r = writeiuser(ip, addr + tot, f->off, m)) > 0)
+      f->off += r;
+    iunlock(ip);
+    end_op();
+    if(r < 0)
+      break;
+  }
+  return tot == n ? n : -1;
+}
+
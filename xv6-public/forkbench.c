@@ -0,0 +1,58 @@
+// Fork latency for processes of 1, 16 and 64 MB.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NFORK 20
+#define MB (1024*1024)
+
+static uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
+void
+bench(int mb)
+{
+  char *mem;
+  uint64 t0, total;
+  int i, pid;
+
+  if((mem = sbrk(mb * MB)) == (char*)-1){
+    printf(2, "forkbench: sbrk %d MB failed\n", mb);
+    return;
+  }
+  for(i = 0; i < mb * MB; i += 4096)
+    mem[i] = i;
+
+  total = 0;
+  for(i = 0; i < NFORK; i++){
+    t0 = rdtsc();
+    pid = fork();
+    if(pid < 0){
+      printf(2, "forkbench: fork failed\n");
+      break;
+    }
+    if(pid == 0)
+      exit();
+    total += rdtsc() - t0;
+    wait();
+  }
+  // In units of 1024 cycles: no 64-bit division in user space.
+  if(i > 0)
+    printf(1, "%d MB: %d forks, %d kcycles/fork\n", mb, i, (uint)(total >> 10) / i);
+  sbrk(-mb * MB);
+}
+
+int
+main(void)
+{
+  bench(1);
+  bench(16);
+  bench(64);
+  exit();
+}
@@ -447,16 +447,18 @@ stati(struct inode *ip, struct stat *st)
 }
 
 //PAGEBREAK!
-// Read data from inode.
+// Read data from inode into dst, a kernel address, or a user
+// address if user is set. A user page that is not ready ends the
+// read early (see copy_to_user_nofault).
 // Caller must hold ip->lock.
-int
-readi(struct inode *ip, char *dst, uint off, uint n)
+static int
+readi1(struct inode *ip, int user, char *dst, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
 
   if(ip->type == T_DEV){
-    if(ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].read)
+    if(user || ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].read)
       return -1;
     return devsw[ip->major].read(ip, dst, n);
   }
@@ -469,23 +471,45 @@ readi(struct inode *ip, char *dst, uint off, uint n)
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
-    memmove(dst, bp->data + off%BSIZE, m);
+    if(!user)
+      memmove(dst, bp->data + off%BSIZE, m);
+    else if(copy_to_user_nofault((uint)dst, bp->data + off%BSIZE, m) < 0){
+      brelse(bp);
+      break;
+    }
     brelse(bp);
   }
-  return n;
+  return tot;
+}
+
+int
+readi(struct inode *ip, char *dst, uint off, uint n)
+{
+  return readi1(ip, 0, dst, off, n);
+}
+
+// Read straight from the buffer cache to user address dst.
+// Returns the bytes copied, which may be short of n at the end
+// of the file or at a user page that is not ready.
+int
+readiuser(struct inode *ip, uint dst, uint off, uint n)
+{
+  return readi1(ip, 1, (char*)dst, off, n);
 }
 
 // PAGEBREAK!
-// Write data to inode.
+// Write data to inode from src, a kernel address, or a user
+// address if user is set. A user page that is not ready ends
+// the write early.
 // Caller must hold ip->lock.
-int
-writei(struct inode *ip, char *src, uint off, uint n)
+static int
+writei1(struct inode *ip, int user, char *src, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
 
   if(ip->type == T_DEV){
-    if(ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].write)
+    if(user || ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].write)
       return -1;
     return devsw[ip->major].write(ip, src, n);
   }
@@ -498,16 +522,36 @@ writei(struct inode *ip, char *src, uint off, uint n)
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
-    memmove(bp->data + off%BSIZE, src, m);
+    if(!user)
+      memmove(bp->data + off%BSIZE, src, m);
+    else if(copy_from_user_nofault(bp->data + off%BSIZE, (uint)src, m) < 0){
+      brelse(bp);
+      break;
+    }
     log_write(bp);
     brelse(bp);
   }
 
-  if(n > 0 && off > ip->size){
+  if(tot > 0 && off > ip->size){
     ip->size = off;
     iupdate(ip);
   }
-  return n;
+  return tot;
+}
+
+int
+writei(struct inode *ip, char *src, uint off, uint n)
+{
+  return writei1(ip, 0, src, off, n);
+}
+
+// Write straight from user address src to the buffer cache.
+// Returns the bytes copied, which may be short of n at a user
+// page that is not ready.
+int
+writeiuser(struct inode *ip, uint src, uint off, uint n)
+{
+  return writei1(ip, 1, (char*)src, off, n);
 }
 
 //PAGEBREAK!
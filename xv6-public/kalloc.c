@@ -7,6 +7,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "proc.h"
 #include "spinlock.h"
 
 static unsigned char ref_count[MAX_PFN] = {0};
@@ -23,6 +24,7 @@ struct {
   struct spinlock lock;
   int use_lock;
   struct run *freelist;
+  uint nfree;  // Pages on freelist
 } kmem;
 
 
@@ -108,15 +110,64 @@ kfree(char *v)
   r = (struct run*)v;
   r->next = kmem.freelist;
   kmem.freelist = r;
+  kmem.nfree++;
   if(kmem.use_lock)
     release(&kmem.lock);
 }
 
-// Allocate one 4096-byte page of physical memory.
-// Returns a pointer that the kernel can use.
-// Returns 0 if the memory cannot be allocated.
-char*
-kalloc(void)
+// Free the n pages in v, as kfree() would each of them, taking
+// kmem.lock twice rather than once per page: once to drop the
+// references, and once to splice the pages that are now free
+// onto the free list. Clears the entries of v.
+void
+kfreen(char **v, int n)
+{
+  struct run *head, *tail, *r;
+  uint pfn;
+  int i, nfree;
+
+  for(i = 0; i < n; i++)
+    if((uint)v[i] % PGSIZE || v[i] < end || V2P(v[i]) >= PHYSTOP)
+      panic("kfreen");
+
+  acquire(&kmem.lock);
+  for(i = 0; i < n; i++){
+    pfn = PFN(V2P(v[i]));
+    if(ref_count[pfn] > 1){
+      ref_count[pfn]--;
+      v[i] = 0;
+    }
+  }
+  release(&kmem.lock);
+
+  // The rest are ours alone now.
+  head = tail = 0;
+  nfree = 0;
+  for(i = 0; i < n; i++){
+    if(v[i] == 0)
+      continue;
+    nfree++;
+    memset(v[i], 1, PGSIZE);
+    r = (struct run*)v[i];
+    r->next = head;
+    head = r;
+    if(tail == 0)
+      tail = r;
+    v[i] = 0;
+  }
+  if(head == 0)
+    return;
+
+  acquire(&kmem.lock);
+  tail->next = kmem.freelist;
+  kmem.freelist = head;
+  kmem.nfree += nfree;
+  release(&kmem.lock);
+}
+
+// Take one page off the free list, or return 0 if it is empty.
+static char*
+kalloc1(void)
 {
   struct run *r;
 
@@ -128,6 +179,7 @@ kalloc(void)
     uint pa = V2P(va);
     uint pfn = PFN(pa);
     kmem.freelist = r->next;
+    kmem.nfree--;
     ref_count[pfn] = 1;
   }
   if(kmem.use_lock)
@@ -135,3 +187,40 @@ kalloc(void)
   return (char*)r;
 }
 
+// Can kalloc() sleep to reclaim memory? Only on behalf of a process,
+// and only if the caller holds no spinlocks.
+static int
+cansleep(void)
+{
+  int ok;
+
+  if(!kmem.use_lock)
+    return 0;
+  pushcli();
+  ok = mycpu()->ncli == 1 && mycpu()->proc != 0;
+  popcli();
+  return ok;
+}
+
+// Pages of memory on the free list right now.
+uint
+kfreecount(void)
+{
+  return kmem.nfree;
+}
+
+// Allocate one 4096-byte page of physical memory.
+// Returns a pointer that the kernel can use.
+// When memory runs out, waits for the reaper to free exited
+// processes' memory, then swaps out user pages to make room,
+// if the caller is able to sleep.
+// Returns 0 if the memory cannot be allocated.
+char*
+kalloc(void)
+{
+  char *r;
+
+  while((r = kalloc1()) == 0 && cansleep() && (reapwait() || reclaim()))
+    ;
+  return r;
+}
@@ -0,0 +1,240 @@
+// Kernel same-page merging.
+//
+// ksmd is a kernel thread that slowly walks the anonymous pages of
+// wmap regions mapped with MAP_MERGEABLE (see ksmscan() in proc.c).
+// A page whose contents match another page's is merged into it: both
+// PTEs point at one frame, read-only with PTE_COW set, and the other
+// frame is freed. The COW fault path in trap.c copies the frame again
+// when either side writes.
+//
+// Merged frames live in the stable table, indexed by a hash of their
+// contents. The table holds a reference on each frame, so a frame in
+// it is never writable and its contents never change. Pages that have
+// no match yet are remembered in the unstable table, which is cleared
+// after every full pass; since those pages are still writable, a
+// match there is only trusted after comparing the contents again.
+//
+// A page is only a candidate if it was not written since the previous
+// pass (PTE_D clear), which keeps ksmd away from pages in active use.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "ksm.h"
+#include "wmap.h"
+
+#define NSTABLE    256  // merged frames
+#define NUNSTABLE  512  // candidate pages
+#define KSMBATCH   64   // pages per ksmd wakeup
+#define KSMSLEEP   10   // ticks between ksmd wakeups
+
+struct stable {
+  uint pa;       // 0 if empty
+  uint hash;
+};
+
+struct unstable {
+  struct proc *p;  // 0 if empty
+  int pid;
+  uint va;
+  uint pa;
+  uint hash;
+};
+
+struct {
+  struct spinlock lock;
+  struct stable stable[NSTABLE];
+  struct unstable unstable[NUNSTABLE];
+  uint nscanned;
+  uint nmerged;
+} ksm;
+
+// FNV-1a over the words of a page.
+static uint
+pagehash(char *page)
+{
+  uint *w = (uint*)page;
+  uint h = 2166136261U;
+  int i;
+
+  for(i = 0; i < PGSIZE/4; i++){
+    h ^= w[i];
+    h *= 16777619U;
+  }
+  return h;
+}
+
+// Point *pte at the merged frame pa and drop the frame it had.
+static void
+mergeinto(pte_t *pte, uint pa)
+{
+  uint old = PTE_ADDR(*pte);
+
+  inc_ref_count(pa);
+  *pte = pa | (PTE_FLAGS(*pte) & ~(PTE_W|PTE_D)) | PTE_COW;
+  kfree(P2V(old));
+  ksm.nmerged++;
+}
+
+// Is the unstable entry u still a page that can be merged?
+static pte_t*
+stillcandidate(struct unstable *u)
+{
+  pte_t *pte;
+
+  if(u->p->pid != u->pid || !reclaimable(u->p))
+    return 0;
+  if((pte = get_pte(u->p->pgdir, (void*)u->va)) == 0)
+    return 0;
+  if(!(*pte & PTE_P) || (*pte & PTE_COW) || PTE_ADDR(*pte) != u->pa)
+    return 0;
+  if(get_ref_count(u->pa) != 1)
+    return 0;
+  return pte;
+}
+
+// Look at the page mapped by pte at va in p, which ksmscan() found
+// in a mergeable region. Called with ptable.lock held, while p
+// cannot be running (see reclaimable()).
+void
+ksmpage(struct proc *p, uint va, pte_t *pte)
+{
+  struct stable *s;
+  struct unstable *u;
+  pte_t *upte;
+  uint pa, h;
+
+  ksm.nscanned++;
+  // Writable pages, and pages wprotect() made read-only.
+  if((*pte & (PTE_P|PTE_U)) != (PTE_P|PTE_U) || (*pte & PTE_COW))
+    return;
+  if(*pte & PTE_D){
+    // Written since the last pass: too soon to tell.
+    *pte &= ~PTE_D;
+    return;
+  }
+  pa = PTE_ADDR(*pte);
+  if(get_ref_count(pa) != 1)
+    return;  // shared with a child; must stay writable
+
+  h = pagehash(P2V(pa));
+  s = &ksm.stable[h % NSTABLE];
+  if(s->pa && s->hash == h && memcmp(P2V(s->pa), P2V(pa), PGSIZE) == 0){
+    mergeinto(pte, s->pa);
+    return;
+  }
+
+  u = &ksm.unstable[h % NUNSTABLE];
+  if(u->p && u->hash == h && u->pa != pa && s->pa == 0 &&
+     (upte = stillcandidate(u)) != 0 &&
+     memcmp(P2V(u->pa), P2V(pa), PGSIZE) == 0){
+    // Promote the older page's frame to the stable table.
+    inc_ref_count(u->pa);
+    *upte = (*upte & ~(PTE_W|PTE_D)) | PTE_COW;
+    s->pa = u->pa;
+    s->hash = h;
+    u->p = 0;
+    mergeinto(pte, s->pa);
+    return;
+  }
+
+  u->p = p;
+  u->pid = p->pid;
+  u->va = va;
+  u->pa = pa;
+  u->hash = h;
+}
+
+// ksmscan() went round the whole process table.
+void
+ksmpass(void)
+{
+  struct stable *s;
+
+  memset(ksm.unstable, 0, sizeof(ksm.unstable));
+  // Let go of merged frames nobody maps any more.
+  for(s = ksm.stable; s < &ksm.stable[NSTABLE]; s++){
+    if(s->pa && get_ref_count(s->pa) == 1){
+      kfree(P2V(s->pa));
+      s->pa = 0;
+    }
+  }
+}
+
+// Give the merged page at va its own frame again, as a write fault
+// would, mapped with perm (the region's protection). fork() uses this
+// so that a MAP_SHARED region stays shared with the child.
+// Returns 0, or -1 if out of memory.
+int
+ksmunmerge(pde_t *pgdir, uint va, uint perm)
+{
+  pte_t *pte;
+  char *mem;
+  uint pa;
+
+  if((pte = get_pte(pgdir, (void*)va)) == 0 || !(*pte & PTE_P) ||
+     !(*pte & PTE_COW))
+    return 0;
+  pa = PTE_ADDR(*pte);
+  if(get_ref_count(pa) == 1){
+    *pte = (*pte & ~(PTE_COW|PTE_W|PTE_U)) | perm;
+  } else {
+    if((mem = kalloc()) == 0)
+      return -1;
+    memmove(mem, P2V(pa), PGSIZE);
+    *pte = V2P(mem) | (PTE_FLAGS(*pte) & ~(PTE_COW|PTE_W|PTE_U)) | perm;
+    kfree(P2V(pa));
+  }
+  lcr3(V2P(pgdir));
+  return 0;
+}
+
+static void
+ksmd(void *arg)
+{
+  for(;;){
+    acquire(&ksm.lock);
+    ksmscan(KSMBATCH);
+    release(&ksm.lock);
+
+    ticksleep(KSMSLEEP);
+  }
+}
+
+void
+ksminit(void)
+{
+  initlock(&ksm.lock, "ksm");
+  kthread_create("ksmd", ksmd, 0, PRIO_IDLE);
+}
+
+int
+getksmstat(struct ksmstat *st)
+{
+  struct stable *s;
+  uint ref;
+
+  acquire(&ksm.lock);
+  st->scanned = ksm.nscanned;
+  st->merged = ksm.nmerged;
+  st->shared = 0;
+  st->saved = 0;
+  for(s = ksm.stable; s < &ksm.stable[NSTABLE]; s++){
+    if(s->pa == 0)
+      continue;
+    // One reference is the table's own, and one frame
+    // would be needed anyway.
+    ref = get_ref_count(s->pa);
+    if(ref > 1)
+      st->shared++;
+    if(ref > 2)
+      st->saved += ref - 2;
+  }
+  release(&ksm.lock);
+  return SUCCESS;
+}
@@ -0,0 +1,10 @@
+#ifndef KSM_H
+#define KSM_H
+// for `getksmstat`
+struct ksmstat {
+    uint scanned;  // Pages looked at by the scanner
+    uint merged;   // Pages merged into another frame with the same contents
+    uint shared;   // Frames currently shared by merged pages
+    uint saved;    // Frames currently saved by merging
+};
+#endif
@@ -9,6 +9,7 @@
 #include "traps.h"
 #include "mmu.h"
 #include "x86.h"
+#include "proc.h"
 
 // Local APIC registers, divided by 4 for use as uint[] indices.
 #define ID      (0x0020/4)   // ID
@@ -41,8 +42,23 @@
 #define TCCR    (0x0390/4)   // Timer Current Count
 #define TDCR    (0x03E0/4)   // Timer Divide Configuration
 
+// PIT channel 2, used once at boot to calibrate against.
+#define PIT_CH2    0x42
+#define PIT_CMD    0x43
+#define PIT_GATE   0x61   // Channel 2 gate (bit 0) and output (bit 5)
+#define PITHZ      1193182
+
+#define NSTICK     (1000000000 / HZ)
+#define MAXARM     64     // Longest the timer is armed for, in ticks
+
 volatile uint *lapic;  // Initialized in mp.c
 
+// Measured by calibrate(): TSC cycles and LAPIC timer counts
+// per clock tick.
+static uint tsctick;
+static uint lapictick;
+static uint64 tscboot;
+
 //PAGEBREAK!
 static void
 lapicw(int index, int value)
@@ -51,6 +67,50 @@ lapicw(int index, int value)
   lapic[ID];  // wait for write to finish, by reading
 }
 
+// n / d and n % d, from two 32-bit divides, since the kernel
+// has no library routine for 64-bit division.
+uint64
+udiv64(uint64 n, uint d, uint *rem)
+{
+  uint hi, lo, r;
+
+  hi = (uint)(n >> 32) / d;
+  r = (uint)(n >> 32) % d;
+  asm volatile("divl %4" : "=a" (lo), "=d" (r) : "a" ((uint)n), "d" (r), "rm" (d));
+  if(rem)
+    *rem = r;
+  return (uint64)hi << 32 | lo;
+}
+
+// Time one clock tick with PIT channel 2, whose frequency is
+// fixed, and count how far the TSC and the LAPIC timer get.
+static void
+calibrate(void)
+{
+  uint latch = PITHZ / HZ;
+  uint64 t0;
+  uint c0;
+
+  lapicw(TDCR, X1);
+  lapicw(TIMER, MASKED);
+  lapicw(TICR, 0xFFFFFFFF);
+
+  // Gate on, speaker off; mode 0 raises the output at terminal count.
+  outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);
+  outb(PIT_CMD, 0xB0);
+  outb(PIT_CH2, latch & 0xFF);
+  outb(PIT_CH2, latch >> 8);
+  c0 = lapic[TCCR];
+  t0 = rdtsc();
+  while((inb(PIT_GATE) & 0x20) == 0)
+    ;
+  tsctick = rdtsc() - t0;
+  lapictick = c0 - lapic[TCCR];
+  tscboot = t0;
+  cprintf("lapic: %d TSC cycles, %d timer counts per tick\n",
+          tsctick, lapictick);
+}
+
 void
 lapicinit(void)
 {
@@ -60,13 +120,16 @@ lapicinit(void)
   // Enable local APIC; set spurious interrupt vector.
   lapicw(SVR, ENABLE | (T_IRQ0 + IRQ_SPURIOUS));
 
-  // The timer repeatedly counts down at bus frequency
-  // from lapic[TICR] and then issues an interrupt.
-  // If xv6 cared more about precise timekeeping,
-  // TICR would be calibrated using an external time source.
+  // The timer counts down once at bus frequency from lapic[TICR]
+  // and then issues an interrupt. lapicarm() reloads it for the
+  // next clock tick or the next high-resolution timer, whichever
+  // is sooner; the tick length comes from calibrate().
+  if(tsctick == 0)
+    calibrate();
   lapicw(TDCR, X1);
-  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 10000000);
+  lapicw(TIMER, T_IRQ0 + IRQ_TIMER);
+  mycpu()->nexttick = rdtsc() + tsctick;
+  lapicw(TICR, lapictick);
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -113,6 +176,108 @@ lapiceoi(void)
     lapicw(EOI, 0);
 }
 
+// Interrupt the CPU with the given APIC ID.
+// Caller must have interrupts disabled.
+void
+lapicipi(uchar apicid, int vector)
+{
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
+// Program the timer to interrupt at TSC value deadline, or at the
+// next clock tick if that is sooner or deadline is 0.
+// Caller must have interrupts disabled.
+void
+lapicarm(uint64 deadline)
+{
+  uint64 now, when;
+  uint n;
+
+  struct cpu *c = mycpu();
+
+  when = c->nohz ? deadline : c->nexttick;
+  if(deadline && deadline < when)
+    when = deadline;
+  if(when == 0){
+    lapicw(TICR, 0);  // nothing to wait for: stop the timer
+    return;
+  }
+  now = rdtsc();
+  n = 1;
+  if(when > now){
+    // Cap the wait so the count fits; an early
+    // interrupt just arms the timer again.
+    if(when - now > (uint64)tsctick * MAXARM)
+      when = now + (uint64)tsctick * MAXARM;
+    n += udiv64((when - now) * lapictick, tsctick, 0);
+  }
+  lapicw(TICR, n);
+}
+
+// Stop this CPU's clock tick while it is idle (on), or restart
+// it one tick from now. Its high-resolution timers still fire.
+// Caller must have interrupts disabled.
+void
+lapicnohz(int on)
+{
+  struct cpu *c = mycpu();
+
+  c->nohz = on;
+  if(!on)
+    c->nexttick = rdtsc() + tsctick;
+  hrarm();
+}
+
+// The timer interrupted. Returns 1 if a clock tick is due,
+// which it then moves on to the next one.
+// Caller must have interrupts disabled.
+int
+lapictimer(void)
+{
+  struct cpu *c = mycpu();
+  uint64 now = rdtsc();
+
+  if(c->nohz || now < c->nexttick)
+    return 0;
+  c->nticks++;
+  c->nexttick += tsctick;
+  if(c->nexttick <= now)  // fell behind; don't try to catch up
+    c->nexttick = now + tsctick;
+  return 1;
+}
+
+// Nanoseconds in n TSC cycles.
+uint64
+cyclestons(uint64 n)
+{
+  uint64 q;
+  uint r;
+
+  q = udiv64(n, tsctick, &r);
+  return q * NSTICK + udiv64((uint64)r * NSTICK, tsctick, 0);
+}
+
+// Nanoseconds since calibrate().
+uint64
+nsuptime(void)
+{
+  return cyclestons(rdtsc() - tscboot);
+}
+
+// TSC cycles in ns nanoseconds.
+uint64
+nstocycles(uint64 ns)
+{
+  uint64 q;
+  uint r;
+
+  q = udiv64(ns, NSTICK, &r);
+  return q * tsctick + udiv64((uint64)r * tsctick, NSTICK, 0);
+}
+
 // Spin for a given number of microseconds.
 // On real hardware would want to tune this dynamically.
 void
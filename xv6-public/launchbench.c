@@ -0,0 +1,102 @@
+// Command launch latency: fork+exec against spawn, timed from
+// the start of the launch until wait() has reaped the child.
+// launchbench [mb ...] runs both with the parent grown to each
+// size in MB in turn, by default 0 and 16.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "spawn.h"
+
+#define NLAUNCH 20
+#define MB (1024*1024)
+
+static char *echoargv[] = { "echo", 0 };
+
+static uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
+// The child is echo with its output closed, which
+// does nothing but start up and exit.
+int
+launch(int usespawn)
+{
+  static struct spawnfa fa[] = { { 1, -1 }, { -1, -1 } };
+  int pid;
+
+  if(usespawn)
+    return spawn(echoargv[0], echoargv, fa);
+  pid = fork();
+  if(pid == 0){
+    close(1);
+    exec(echoargv[0], echoargv);
+    exit();
+  }
+  return pid;
+}
+
+void
+bench(char *what, int usespawn)
+{
+  uint64 t0, total;
+  int i;
+
+  total = 0;
+  for(i = 0; i < NLAUNCH; i++){
+    t0 = rdtsc();
+    if(launch(usespawn) < 0){
+      printf(2, "launchbench: %s failed\n", what);
+      break;
+    }
+    wait();
+    total += rdtsc() - t0;
+  }
+  // In units of 1024 cycles: no 64-bit division in user space.
+  if(i > 0)
+    printf(1, "%s: %d launches, %d kcycles/launch\n", what, i, (uint)(total >> 10) / i);
+}
+
+// Grow the parent to mb MB of touched memory beyond
+// what it started with. Returns -1 if it can't.
+int
+grow(int mb)
+{
+  static int have;
+  char *mem;
+  int i;
+
+  if(mb <= have)
+    return 0;
+  if((mem = sbrk((mb - have) * MB)) == (char*)-1)
+    return -1;
+  for(i = 0; i < (mb - have) * MB; i += 4096)
+    mem[i] = i;
+  have = mb;
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  static char *sizes[] = { "0", "16" };
+  char **mb;
+  int i, n;
+
+  mb = argc > 1 ? argv + 1 : sizes;
+  n = argc > 1 ? argc - 1 : sizeof(sizes) / sizeof(sizes[0]);
+  for(i = 0; i < n; i++){
+    if(grow(atoi(mb[i])) < 0){
+      printf(2, "launchbench: sbrk %s MB failed\n", mb[i]);
+      break;
+    }
+    printf(1, "parent %s MB\n", mb[i]);
+    bench("fork+exec", 0);
+    bench("spawn", 1);
+  }
+  exit();
+}
@@ -0,0 +1,64 @@
+// Print spin lock statistics.
+//   lockstat            print the counts so far
+//   lockstat on | off   start (from zero) or stop counting
+//   lockstat cmd args   count while cmd runs, then print
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "lockstat.h"
+
+struct lockstat st[NLOCKSTAT];
+
+void
+print(void)
+{
+  int i, n;
+
+  if((n = lockstat(LS_READ, st, NLOCKSTAT)) < 0){
+    printf(2, "lockstat: failed\n");
+    exit();
+  }
+  printf(1, "name\t\tlocks\tacquires\tcontended\tspin kcycles\tmax hold\n");
+  for(i = 0; i < n; i++){
+    if(st[i].acquires == 0)
+      continue;
+    printf(1, "%s\t%s%d\t%d\t\t%d\t\t%d\t\t%d\n", st[i].name,
+           strlen(st[i].name) < 8 ? "\t" : "", st[i].nlocks,
+           st[i].acquires, st[i].contended, st[i].spin, st[i].maxhold);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc == 1){
+    print();
+    exit();
+  }
+  if(argc == 2 && strcmp(argv[1], "on") == 0){
+    lockstat(LS_ON, 0, 0);
+    exit();
+  }
+  if(argc == 2 && strcmp(argv[1], "off") == 0){
+    lockstat(LS_OFF, 0, 0);
+    exit();
+  }
+
+  lockstat(LS_ON, 0, 0);
+  if((pid = fork()) < 0){
+    printf(2, "lockstat: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    printf(2, "lockstat: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  lockstat(LS_OFF, 0, 0);
+  print();
+  exit();
+}
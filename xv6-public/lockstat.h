@@ -0,0 +1,19 @@
+#ifndef LOCKSTAT_H
+#define LOCKSTAT_H
+#define NLOCKSTAT 32  // most lock names lockstat() reports on
+
+// lockstat() operations
+#define LS_READ   0   // copy out the counts
+#define LS_ON     1   // clear the counts and start counting
+#define LS_OFF    2   // stop counting
+
+// for `lockstat`, one per lock name
+struct lockstat {
+    char name[16];   // Lock name
+    uint nlocks;     // Locks with that name
+    uint acquires;   // Acquisitions
+    uint contended;  // that had to wait for another CPU
+    uint spin;       // Kilocycles spent waiting
+    uint maxhold;    // Longest hold, in cycles
+};
+#endif
@@ -1,6 +1,8 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "mmu.h"
+#include "proc.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "fs.h"
@@ -134,6 +136,7 @@ begin_op(void)
       sleep(&log, &log.lock);
     } else {
       log.outstanding += 1;
+      myproc()->nfsop++;
       release(&log.lock);
       break;
     }
@@ -149,6 +152,7 @@ end_op(void)
 
   acquire(&log.lock);
   log.outstanding -= 1;
+  myproc()->nfsop--;
   if(log.committing)
     panic("log.committing");
   if(log.outstanding == 0){
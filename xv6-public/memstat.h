@@ -0,0 +1,25 @@
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+// for `getmemstat`
+struct memstat {
+    uint minflt;   // Faults resolved without waiting for I/O
+    uint majflt;   // Faults that read the disk or waited on a handler
+    uint cowflt;   // Writes to a COW page that broke the sharing
+    uint zerofill; // Pages zero-filled on a fault
+    uint fileread; // Pages read from a file on a fault
+    uint rss;      // Resident user pages
+    uint ptpages;  // Page-table pages for user memory
+};
+
+// for `getfaulthist`
+#define FK_ZERO   0  // Anonymous page zero-filled
+#define FK_FILE   1  // Page read from a mapped file or program text
+#define FK_COW    2  // COW page copied or taken over
+#define FK_SWAP   3  // Page swapped back in
+#define FK_UFAULT 4  // Page filled by a userfault handler
+#define NFAULTKIND 5
+#define NFAULTBIN 32 // Bin b counts faults of [2^b, 2^(b+1)) cycles
+struct faulthist {
+    uint count[NFAULTKIND][NFAULTBIN];
+};
+#endif
@@ -17,9 +17,10 @@
 #define SEG_UCODE 3  // user code
 #define SEG_UDATA 4  // user data+stack
 #define SEG_TSS   5  // this process's task state
+#define SEG_KCPU  6  // this CPU's struct cpu, in %gs (see mycpu)
 
 // cpu->gdt[NSEGS] holds the above segments.
-#define NSEGS     6
+#define NSEGS     7
 
 #ifndef __ASSEMBLER__
 // Segment Descriptor
@@ -83,6 +84,7 @@ struct segdesc {
 #define NPDENTRIES      1024    // # directory entries per page directory
 #define NPTENTRIES      1024    // # PTEs per page table
 #define PGSIZE          4096    // bytes mapped by a page
+#define PTSIZE          (PGSIZE*NPTENTRIES) // bytes mapped by a page table
 
 #define PTXSHIFT        12      // offset of PTX in a linear address
 #define PDXSHIFT        22      // offset of PDX in a linear address
@@ -94,14 +96,28 @@ struct segdesc {
 #define PTE_P           0x001   // Present
 #define PTE_W           0x002   // Writeable
 #define PTE_U           0x004   // User
+#define PTE_A           0x020   // Accessed
+#define PTE_D           0x040   // Dirty
 #define PTE_PS          0x080   // Page Size
 #define PTE_COW 0x200
+#define PTE_SWAP        0x400   // Not present, contents in swap slot
 #define MAX_PFN 1024 * 1024
 #define PFN(a) (uint) a >> 12
 // Address in page table or page directory entry
 #define PTE_ADDR(pte)   ((uint)(pte) & ~0xFFF)
 #define PTE_FLAGS(pte)  ((uint)(pte) &  0xFFF)
 
+// A swapped-out PTE keeps the slot number in the address bits and
+// the page's PTE_W/PTE_U/PTE_COW bits, with PTE_P clear.
+#define SWAPSLOT(pte)         ((uint)(pte) >> PTXSHIFT)
+#define SWAPPTE(slot, flags)  (((uint)(slot) << PTXSHIFT) | PTE_SWAP | \
+                               ((flags) & (PTE_W|PTE_U|PTE_COW)))
+
+// Page fault error code bits (tf->err)
+#define FEC_PR          0x001   // Protection violation (page was present)
+#define FEC_WR          0x002   // Caused by a write
+#define FEC_U           0x004   // Occurred in user mode
+
 #ifndef __ASSEMBLER__
 typedef uint pte_t;
 
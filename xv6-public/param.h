@@ -11,4 +11,8 @@
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       1000  // size of file system in blocks
+#define SWAPBLOCKS   8192  // size of swap area after the file system, in blocks
+#define ZSWAPPAGES   256  // max pages of memory holding compressed swap
 
+#define HZ           100  // clock ticks per second
+#define MLFQBOOST    100  // ticks between MLFQ priority boosts
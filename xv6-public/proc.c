@@ -10,24 +10,66 @@
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "spawn.h"
+#include "traps.h"
+
+// Sleeping processes are kept on wait queues hashed by channel,
+// so that wakeup() looks only at those that might be on its chan.
+#define SLEEPQBITS 6
+#define NSLEEPQ (1 << SLEEPQBITS)
+#define SLEEPQ(chan) (((uint)(chan) * 2654435761U) >> (32 - SLEEPQBITS))
 
 struct {
   struct spinlock lock;
   struct proc proc[NPROC];
+  struct memstat reaped;  // Fault counts of processes wait() freed
+  struct proc *sleepq[NSLEEPQ];  // Linked through sleepnext
 } ptable;
 
+// Faults in MAP_USERFAULT regions waiting for wfill().
+#define NUFAULT NPROC
+struct ufault {
+  int pid;     // 0 if free
+  uint addr;
+  int handler; // Pid of the map's handler, the only one who sees it
+  int read;    // Handed to a handler by wfault()
+  int filled;  // Page installed by wfill()
+};
+
+struct {
+  struct spinlock lock;
+  struct ufault fault[NUFAULT];
+} uftable;
+
+// Each CPU's run queue has its own lock, so that CPUs looking for
+// work contend only for the queue they take from. The lock order
+// is ptable.lock, then one runq lock. scheduler() picks a process
+// holding just the lock of the queue it is on, then takes
+// ptable.lock to run it (see pickproc).
+static struct spinlock rqlock[NCPU];
+#define RQLOCK(c) (&rqlock[(c) - cpus])
+
 static struct proc *initproc;
 
 int nextpid = 1;
+static uint nextmapid = 1;  // for wmap()
 extern void forkret(void);
 extern void trapret(void);
+extern pde_t *kpgdir;
 
 static void wakeup1(void *chan);
+static void setrunnable(struct proc *p);
+static void addfaults(struct memstat *to, struct memstat *from);
 
 void
 pinit(void)
 {
+  int i;
+
   initlock(&ptable.lock, "ptable");
+  initlock(&uftable.lock, "uftable");
+  for(i = 0; i < NCPU; i++)
+    initlock(&rqlock[i], "runq");
 }
 
 // Must be called with interrupts disabled
@@ -36,36 +78,27 @@ cpuid() {
   return mycpu()-cpus;
 }
 
-// Must be called with interrupts disabled to avoid the caller being
-// rescheduled between reading lapicid and running through the loop.
+// This CPU's struct cpu, which seginit() put at %gs:0.
+// Must be called with interrupts disabled to avoid the caller
+// being rescheduled onto another CPU while using the result.
 struct cpu*
 mycpu(void)
 {
-  int apicid, i;
-  
-  if(readeflags()&FL_IF)
-    panic("mycpu called with interrupts enabled\n");
-  
-  apicid = lapicid();
-  // APIC IDs are not guaranteed to be contiguous. Maybe we should have
-  // a reverse map, or reserve a register to store &cpus[i].
-  for (i = 0; i < ncpu; ++i) {
-    if (cpus[i].apicid == apicid)
-      return &cpus[i];
-  }
-  panic("unknown apicid\n");
+  struct cpu *c;
+
+  asm volatile("movl %%gs:0, %0" : "=r" (c));
+  return c;
 }
 
-// Disable interrupts so that we are not rescheduled
-// while reading proc from the cpu structure
+// The process running on this CPU. A single load from the
+// per-CPU segment, so it needs no pushcli: if we are moved to
+// another CPU right after, we are the process running there.
 struct proc*
 myproc(void) {
-  struct cpu *c;
   struct proc *p;
-  pushcli();
-  c = mycpu();
-  p = c->proc;
-  popcli();
+
+  asm volatile("movl %%gs:%c1, %0" : "=r" (p)
+               : "i" (__builtin_offsetof(struct cpu, proc)));
   return p;
 }
 
@@ -93,7 +126,17 @@ found:
   p->state = EMBRYO;
   p->pid = nextpid++;
 
+  p->prio = PRIO_USER;
+  p->affinity = ALLCPUS;
+  p->lastcpu = -1;
+  p->pinned = 0;
+  p->slice = 0;
+  p->waitsum = 0;
+  memset(&p->sstat, 0, sizeof(p->sstat));
   p->mmap_count = 0;
+  p->inuser = 0;
+  p->nfsop = 0;
+  memset(&p->mstat, 0, sizeof(p->mstat));
 
   release(&ptable.lock);
 
@@ -121,6 +164,44 @@ found:
   return p;
 }
 
+// A kernel thread starts here; see kthread_create.
+static void
+kthreadmain(void)
+{
+  struct proc *p = myproc();
+
+  // Still holding ptable.lock from scheduler.
+  release(&ptable.lock);
+  p->kfn(p->karg);
+  panic("kthread returned");
+}
+
+// Start a kernel thread running fn(arg) at priority prio. It has
+// no user memory, runs on the kernel-only page table, never returns
+// to user space, and runs until the machine stops. It has no parent
+// to wait for it, and cannot be killed.
+struct proc*
+kthread_create(char *name, void (*fn)(void*), void *arg, int prio)
+{
+  struct proc *p;
+
+  if((p = allocproc()) == 0)
+    panic("kthread_create: no proc");
+  p->pgdir = kpgdir;
+  p->sz = 0;
+  p->parent = 0;
+  p->prio = prio;
+  p->kfn = fn;
+  p->karg = arg;
+  p->context->eip = (uint)kthreadmain;
+  safestrcpy(p->name, name, sizeof(p->name));
+
+  acquire(&ptable.lock);
+  setrunnable(p);
+  release(&ptable.lock);
+  return p;
+}
+
 //PAGEBREAK: 32
 // Set up first user process.
 void
@@ -136,6 +217,7 @@ userinit(void)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
   p->sz = PGSIZE;
+  p->mstat.rss = 1;
   memset(p->tf, 0, sizeof(*p->tf));
   p->tf->cs = (SEG_UCODE << 3) | DPL_USER;
   p->tf->ds = (SEG_UDATA << 3) | DPL_USER;
@@ -154,7 +236,7 @@ userinit(void)
   // because the assignment might not be atomic.
   acquire(&ptable.lock);
 
-  p->state = RUNNABLE;
+  setrunnable(p);
 
   release(&ptable.lock);
 }
@@ -171,7 +253,9 @@ growproc(int n)
   if(n > 0){
     if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
       return -1;
+    curproc->mstat.rss += (PGROUNDUP(sz) - PGROUNDUP(curproc->sz)) / PGSIZE;
   } else if(n < 0){
+    curproc->mstat.rss -= resident(curproc->pgdir, PGROUNDUP(sz + n), sz);
     if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
       return -1;
   }
@@ -186,14 +270,25 @@ int mmap_copy_page_tables(struct mmap_region *region, pde_t *parent_pgdir, struc
 
     for (i = region->addr; i < region->addr + region->length; i += PGSIZE) {
         pte = get_pte(parent_pgdir, (void *)i);
+        // Shared maps must stay shared, so bring swapped pages back
+        // rather than giving each process its own copy of the slot.
+        if (pte && (*pte & PTE_SWAP)) {
+            if (swapin(parent_pgdir, i) < 0)
+                return -1;
+            region->nloaded++;
+        }
         if (pte == 0 || !(*pte & PTE_P))
             continue;
+        // Likewise a page ksmd merged must be the parent's own again.
+        if ((*pte & PTE_COW) && ksmunmerge(parent_pgdir, i, regionperm(region)) < 0)
+            return -1;
 
         if (perform_mapping(child_pgdir, (void *)i, PGSIZE, PTE_ADDR(*pte), PTE_FLAGS(*pte)) < 0) {
             return -1;
         }
 
         inc_ref_count(PTE_ADDR(*pte));
+        child_region->nloaded++;
     }
 
     return 0;
@@ -201,7 +296,7 @@ int mmap_copy_page_tables(struct mmap_region *region, pde_t *parent_pgdir, struc
 
 int copy_mmap_regions(struct proc *parent, struct proc *child) {
     struct mmap_region *parent_region, *child_region;
-    int i;
+    int i, n;
 
     for (i = 0; i < parent->mmap_count; i++) {
         parent_region = &parent->mmap_regions[i];
@@ -217,13 +312,21 @@ int copy_mmap_regions(struct proc *parent, struct proc *child) {
         child_region->flags = parent_region->flags;
         child_region->fd = parent_region->fd;
         child_region->file = parent_region->file;
+        child_region->base = parent_region->base;
+        child_region->prot = parent_region->prot;
+        child_region->id = parent_region->id;
+        child_region->handler = parent_region->handler;
+        child_region->nloaded = 0;
 
         child->mmap_count++;
 
 
+        n = parent_region->nloaded;
         if (mmap_copy_page_tables(parent_region, parent->pgdir, child_region, child->pgdir) < 0) {
             return -1;
         }
+        parent->mstat.rss += parent_region->nloaded - n;
+        child->mstat.rss += child_region->nloaded;
     }
 
     return 0;
@@ -251,8 +354,23 @@ fork(void)
     np->state = UNUSED;
     return -1;
   }
+  // All of curproc's resident pages below sz are now np's too;
+  // copy_mmap_regions() counts the maps.
+  np->mstat.rss = curproc->mstat.rss;
+  for(i = 0; i < curproc->mmap_count; i++)
+    np->mstat.rss -= curproc->mmap_regions[i].nloaded;
+  // Copy the maps before np can run; this may sleep
+  // to swap pages back in.
+  if(copy_mmap_regions(curproc, np) < 0){
+    freevm(np->pgdir);
+    kfree(np->kstack);
+    np->kstack = 0;
+    np->state = UNUSED;
+    return -1;
+  }
   np->sz = curproc->sz;
   np->parent = curproc;
+  np->affinity = curproc->affinity;
   *np->tf = *curproc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -262,6 +380,10 @@ fork(void)
     if(curproc->ofile[i])
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
+  if(curproc->exe)
+    np->exe = idup(curproc->exe);
+  memmove(np->text, curproc->text, sizeof(curproc->text));
+  np->ntext = curproc->ntext;
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
@@ -269,14 +391,78 @@ fork(void)
 
   acquire(&ptable.lock);
 
-  np->state = RUNNABLE;
+  setrunnable(np);
+
+  release(&ptable.lock);
+  return pid;
+}
+
+// Start the program at path in a new child process, as fork()
+// followed by exec() would, but build the child's image straight
+// from the executable instead of copying the caller's memory.
+// The child gets the caller's open files with the actions in fa
+// applied. Returns the child's pid, or -1.
+int
+spawn(char *path, char **argv, struct spawnfa *fa, int nfa)
+{
+  int i, pid;
+  struct proc *np;
+  struct image im;
+  struct file *f;
+  struct proc *curproc = myproc();
 
-  if (copy_mmap_regions(curproc, np) < 0) {
+  for(i = 0; i < nfa; i++){
+    if(fa[i].fd >= NOFILE || fa[i].src >= NOFILE)
+      return -1;
+    if(fa[i].src >= 0 && curproc->ofile[fa[i].src] == 0)
+      return -1;
+  }
+
+  if((np = allocproc()) == 0)
+    return -1;
+  if(loadimage(path, argv, &im) < 0){
     kfree(np->kstack);
     np->kstack = 0;
     np->state = UNUSED;
     return -1;
   }
+  np->pgdir = im.pgdir;
+  np->sz = im.sz;
+  np->exe = im.exe;
+  memmove(np->text, im.text, sizeof(im.text));
+  np->ntext = im.ntext;
+  np->mstat.rss = im.sz / PGSIZE;
+  np->parent = curproc;
+  np->affinity = curproc->affinity;
+
+  memset(np->tf, 0, sizeof(*np->tf));
+  np->tf->cs = (SEG_UCODE << 3) | DPL_USER;
+  np->tf->ds = (SEG_UDATA << 3) | DPL_USER;
+  np->tf->es = np->tf->ds;
+  np->tf->ss = np->tf->ds;
+  np->tf->eflags = FL_IF;
+  np->tf->esp = im.sp;
+  np->tf->eip = im.entry;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  for(i = 0; i < nfa; i++){
+    f = fa[i].src >= 0 ? filedup(curproc->ofile[fa[i].src]) : 0;
+    if(np->ofile[fa[i].fd])
+      fileclose(np->ofile[fa[i].fd]);
+    np->ofile[fa[i].fd] = f;
+  }
+  np->cwd = idup(curproc->cwd);
+
+  safestrcpy(np->name, im.name, sizeof(np->name));
+
+  pid = np->pid;
+
+  acquire(&ptable.lock);
+
+  setrunnable(np);
+
   release(&ptable.lock);
   return pid;
 }
@@ -304,8 +490,11 @@ exit(void)
 
   begin_op();
   iput(curproc->cwd);
+  if(curproc->exe)
+    iput(curproc->exe);
   end_op();
   curproc->cwd = 0;
+  curproc->exe = 0;
 
   acquire(&ptable.lock);
 
@@ -333,6 +522,7 @@ int
 wait(void)
 {
   struct proc *p;
+  pde_t *pgdir;
   int havekids, pid;
   struct proc *curproc = myproc();
   
@@ -349,13 +539,18 @@ wait(void)
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
-        freevm(p->pgdir);
+        pgdir = p->pgdir;
+        p->pgdir = 0;
+        addfaults(&ptable.reaped, &p->mstat);
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
         p->state = UNUSED;
         release(&ptable.lock);
+        // Tearing down a large address space takes a while;
+        // the reaper thread does it in the background.
+        freevmlater(pgdir);
         return pid;
       }
     }
@@ -371,6 +566,276 @@ wait(void)
   }
 }
 
+// MLFQ quantum of each level, in ticks.
+static int quantum[NMLFQ] = { 1, 2, 4 };
+
+// May p run on c?
+static int
+canrun(struct proc *p, struct cpu *c)
+{
+  return (p->affinity >> (c - cpus)) & 1;
+}
+
+// Get an idle CPU out of hlt in scheduler() to look for work.
+static void
+kick(struct cpu *c)
+{
+  c->kicked = 1;
+  lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
+}
+
+// Append p to the queue for its priority on c.
+// Caller holds c's runq lock.
+static void
+rqadd(struct cpu *c, struct proc *p)
+{
+  struct runq *rq = &c->rq;
+
+  p->rqcpu = c;
+  p->rqnext = 0;
+  p->onrq = 1;
+  if(rq->tail[p->prio])
+    rq->tail[p->prio]->rqnext = p;
+  else
+    rq->head[p->prio] = p;
+  rq->tail[p->prio] = p;
+  rq->prios |= 1 << p->prio;
+  rq->n++;
+}
+
+// Take p off its run queue. Caller holds that queue's lock.
+static void
+rqdel(struct proc *p)
+{
+  struct runq *rq = &p->rqcpu->rq;
+  struct proc *q, *prev;
+
+  prev = 0;
+  for(q = rq->head[p->prio]; q != p; q = q->rqnext)
+    prev = q;
+  if(prev)
+    prev->rqnext = p->rqnext;
+  else
+    rq->head[p->prio] = p->rqnext;
+  if(rq->tail[p->prio] == p)
+    rq->tail[p->prio] = prev;
+  if(rq->head[p->prio] == 0)
+    rq->prios &= ~(1 << p->prio);
+  p->onrq = 0;
+  rq->n--;
+}
+
+static void
+enqueue(struct cpu *c, struct proc *p)
+{
+  acquire(RQLOCK(c));
+  rqadd(c, p);
+  release(RQLOCK(c));
+}
+
+// Queue p on this CPU if it may run here, else on the CPU it
+// last ran on or the first it may run on.
+static void
+place(struct proc *p)
+{
+  struct cpu *c = mycpu(), *o;
+
+  if(!canrun(p, c)){
+    if(p->lastcpu >= 0 && canrun(p, &cpus[p->lastcpu]))
+      c = &cpus[p->lastcpu];
+    else
+      for(c = cpus; !canrun(p, c); c++)
+        ;
+  }
+  enqueue(c, p);
+
+  // Pairs with the barrier in scheduler(): either it sees p
+  // queued, or we see it idle.
+  __sync_synchronize();
+  if(!c->idle){
+    // c is busy. Idle CPUs have their clock tick stopped, so
+    // get one that may run p to come and steal it.
+    for(o = cpus; o < &cpus[ncpu]; o++)
+      if(o != c && o->idle && !o->kicked && canrun(p, o))
+        break;
+    if(o == &cpus[ncpu])
+      return;
+    c = o;
+  }
+  if(c == mycpu())
+    c->kicked = 1;  // An interrupt in scheduler(); no need for an IPI.
+  else
+    kick(c);
+}
+
+// Mark p runnable and queue it, on this CPU if its affinity
+// allows; an idle CPU will steal it if this one is busy.
+// Caller holds ptable.lock.
+static void
+setrunnable(struct proc *p)
+{
+  p->state = RUNNABLE;
+  p->qstamp = rdtsc();
+  place(p);
+}
+
+// Change p's priority. If p is queued, it moves to the back
+// of the queue for its new priority. Caller holds ptable.lock.
+static void
+setprio(struct proc *p, int prio)
+{
+  struct cpu *c = p->rqcpu;
+
+  if(p->state != RUNNABLE){
+    p->prio = prio;
+    return;
+  }
+  acquire(RQLOCK(c));
+  if(p->onrq){
+    rqdel(p);
+    p->prio = prio;
+    rqadd(c, p);
+  } else
+    p->prio = prio;  // A CPU has picked it to run.
+  release(RQLOCK(c));
+}
+
+// The first process queued on o at priority prio that may run
+// on c, or 0. Caller holds o's runq lock.
+static struct proc*
+firstfor(struct cpu *o, int prio, struct cpu *c)
+{
+  struct proc *p;
+
+  for(p = o->rq.head[prio]; p; p = p->rqnext)
+    if(canrun(p, c))
+      break;
+  return p;
+}
+
+// The best priority of a process queued on o that may run
+// on c, or NPRIO if there is none. Caller holds o's runq lock.
+static int
+rqprio(struct cpu *o, struct cpu *c)
+{
+  int prio;
+
+  for(prio = 0; prio < NPRIO; prio++)
+    if((o->rq.prios & (1 << prio)) && firstfor(o, prio, c))
+      break;
+  return prio;
+}
+
+// The best priority queued on o, whatever may run it, or NPRIO.
+// Looks without the lock, so it can be stale.
+static int
+peekprio(struct cpu *o)
+{
+  uint prios = o->rq.prios;
+  int prio;
+
+  for(prio = 0; prio < NPRIO && !(prios & (1 << prio)); prio++)
+    ;
+  return prio;
+}
+
+// Choose a process for c to run and take it off its queue: the
+// first of the best priority queued anywhere that may run on c,
+// from c's own queue if it has one, else stolen from the busiest
+// queue that does. Returns 0 if there is none.
+// The queues are compared by peeking, and only the chosen one is
+// locked; if it turns out to hold nothing c may run, the next
+// best is tried. Caller holds no locks: the process picked is off
+// its queue but still RUNNABLE until c takes ptable.lock to run it.
+static struct proc*
+pickproc(struct cpu *c)
+{
+  struct cpu *o, *victim;
+  struct proc *p;
+  int prio, best;
+  uint tried;
+
+  for(tried = 0;;){
+    victim = 0;
+    best = NPRIO;
+    for(o = cpus; o < &cpus[ncpu]; o++){
+      if(tried & (1 << (o - cpus)))
+        continue;
+      prio = peekprio(o);
+      if(prio < best || (prio == best && prio < NPRIO && victim != c &&
+         (o == c || o->rq.n > victim->rq.n))){
+        victim = o;
+        best = prio;
+      }
+    }
+    if(victim == 0)
+      return 0;
+
+    acquire(RQLOCK(victim));
+    if((prio = rqprio(victim, c)) < NPRIO){
+      p = firstfor(victim, prio, c);
+      rqdel(p);
+      release(RQLOCK(victim));
+      return p;
+    }
+    release(RQLOCK(victim));
+    tried |= 1 << (victim - cpus);
+  }
+}
+
+// The best priority queued on any CPU of a process that may
+// run on c, or NPRIO if none. Only a queue whose peek beats
+// the best found so far is locked to look at affinities.
+static int
+topprio(struct cpu *c)
+{
+  struct cpu *o;
+  int prio, best;
+
+  best = NPRIO;
+  for(o = cpus; o < &cpus[ncpu]; o++){
+    if(peekprio(o) >= best)
+      continue;
+    acquire(RQLOCK(o));
+    if((prio = rqprio(o, c)) < best)
+      best = prio;
+    release(RQLOCK(o));
+  }
+  return best;
+}
+
+// Is anything queued on any CPU? Looks without the locks,
+// so the answer can be stale by the time it is used.
+static int
+queued(void)
+{
+  struct cpu *c;
+
+  for(c = cpus; c < &cpus[ncpu]; c++)
+    if(c->rq.n)
+      return 1;
+  return 0;
+}
+
+// Halt until an interrupt. Except on CPU 0, which keeps ticks
+// for everyone, the clock tick is stopped meanwhile: there is
+// nothing running to charge it to, and work for this CPU comes
+// with a kick (see place). Caller has interrupts disabled.
+static void
+idle(struct cpu *c)
+{
+  if(c != cpus)
+    lapicnohz(1);
+  c->nhalts++;
+  c->idlestart = rdtsc();
+  stihlt();
+  cli();
+  c->idlecycles += rdtsc() - c->idlestart;
+  c->idlestart = 0;
+  if(c != cpus)
+    lapicnohz(0);
+}
+
 //PAGEBREAK: 42
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
@@ -384,17 +849,41 @@ scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  uint64 wait;
   c->proc = 0;
   
   for(;;){
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    // While this CPU looks for work it counts as idle, so that
+    // anyone queueing work for it meanwhile kicks it (see place
+    // and wakepreempt). Peeking at the queues without their locks
+    // keeps idle CPUs from hammering them, and ptable.lock is
+    // taken only once there is a process to run.
+    c->kicked = 0;
+    c->idle = 1;
+    __sync_synchronize();
+    p = 0;
+    if(queued() && (p = pickproc(c)) != 0){
+      acquire(&ptable.lock);
       if(p->state != RUNNABLE)
+        panic("scheduler runnable");
+      if(!canrun(p, c)){
+        // setaffinity() moved it off c while c was picking it.
+        place(p);
+        release(&ptable.lock);
         continue;
+      }
+      c->idle = 0;
+      wait = rdtsc() - p->qstamp;
+      p->waitsum += wait;
+      if(wait > p->sstat.maxwait)
+        p->sstat.maxwait = wait;
+      p->sstat.nsched++;
+      if(p->lastcpu >= 0 && p->lastcpu != c - cpus)
+        p->sstat.migrations++;
+      p->lastcpu = c - cpus;
 
       // Switch to chosen process.  It is the process's job
       // to release ptable.lock and then reacquire it
@@ -402,6 +891,7 @@ scheduler(void)
       c->proc = p;
       switchuvm(p);
       p->state = RUNNING;
+      p->resched = 0;
 
       swtch(&(c->scheduler), p->context);
       switchkvm();
@@ -409,9 +899,17 @@ scheduler(void)
       // Process is done running for now.
       // It should have changed its p->state before coming back.
       c->proc = 0;
+      release(&ptable.lock);
     }
-    release(&ptable.lock);
 
+    // Nothing this CPU may run: wait for an interrupt,
+    // unless someone kicked it while it was looking.
+    if(p == 0){
+      cli();
+      if(!c->kicked)
+        idle(c);
+    }
+    c->idle = 0;
   }
 }
 
@@ -441,12 +939,188 @@ sched(void)
   mycpu()->intena = intena;
 }
 
+// Called on each timer tick by the process running on this CPU.
+// A user process is charged the tick at its MLFQ level. It gives
+// up the CPU once its quantum there is used up, moving down a
+// level unless pinned, or sooner if something of better priority
+// is waiting or a wakeup asked for the CPU (see wakepreempt), as
+// one raised by this very tick will have. Kernel threads give up
+// the CPU every tick.
+void
+schedtick(void)
+{
+  struct proc *p = myproc();
+  int level, resched, best;
+
+  // Look at the run queues before taking ptable.lock.
+  best = p->kfn ? 0 : topprio(mycpu());
+
+  acquire(&ptable.lock);
+  p->sstat.ticks++;
+  resched = 1;
+  if(p->kfn == 0){
+    level = p->prio - PRIO_USER;
+    if(++p->slice >= quantum[level]){
+      p->slice = 0;
+      if(!p->pinned && level < NMLFQ-1)
+        p->prio++;
+    } else if(best >= p->prio && !p->resched)
+      resched = 0;
+  }
+  if(resched){
+    setrunnable(p);
+    sched();
+  }
+  release(&ptable.lock);
+}
+
+// Move every user process that is not pinned back to the top MLFQ
+// level, so that CPU-bound ones demoted long ago still get to run.
+// Called every MLFQBOOST ticks.
+void
+mlfqboost(void)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state == UNUSED || p->kfn || p->pinned)
+      continue;
+    p->slice = 0;
+    if(p->prio != PRIO_USER)
+      setprio(p, PRIO_USER);
+  }
+  release(&ptable.lock);
+}
+
+// Pin process pid at MLFQ level, or with level -1
+// let it move between levels again.
+int
+setpriority(int pid, int level)
+{
+  struct proc *p;
+
+  if(level < -1 || level >= NMLFQ)
+    return -1;
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED && p->kfn == 0){
+      p->slice = 0;
+      p->pinned = level >= 0;
+      if(p->pinned)
+        setprio(p, PRIO_USER + level);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Let process pid run only on the CPUs in mask, bit i for cpus[i].
+// It moves at once if it is queued or running on another CPU.
+int
+setaffinity(int pid, uint mask)
+{
+  struct proc *p;
+  struct cpu *c;
+  int onrq;
+
+  if((mask & ((1 << ncpu) - 1)) == 0 || (mask & ~ALLCPUS))
+    return -1;
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED){
+      p->affinity = mask;
+      if(p->state == RUNNABLE && !canrun(p, c = p->rqcpu)){
+        // If it is not on c's queue, c has picked it and
+        // will put it back (see scheduler).
+        acquire(RQLOCK(c));
+        if((onrq = p->onrq) != 0)
+          rqdel(p);
+        release(RQLOCK(c));
+        if(onrq)
+          place(p);
+      } else if(p->state == RUNNING && !canrun(p, c = &cpus[p->lastcpu])){
+        // Interrupt it so that it gives up the CPU.
+        p->resched = 1;
+        if(c != mycpu())
+          lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
+      }
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// The CPUs process pid may run on, or -1.
+int
+getaffinity(int pid)
+{
+  struct proc *p;
+  int mask;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED){
+      mask = p->affinity;
+      release(&ptable.lock);
+      return mask;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+int
+getschedstats(int pid, struct schedstat *st)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED){
+      *st = p->sstat;
+      st->level = p->kfn ? -1 : p->prio - PRIO_USER;
+      st->pinned = p->pinned;
+      st->cpu = p->lastcpu;
+      st->avgwait = average(p->waitsum, p->sstat.nsched);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+int
+getcpustat(int cpu, struct cpustat *st)
+{
+  struct cpu *c;
+  uint64 idle, t0;
+
+  if(cpu < 0 || cpu >= ncpu)
+    return -1;
+  c = &cpus[cpu];
+  idle = c->idlecycles;
+  if((t0 = c->idlestart) != 0)  // halted right now
+    idle += rdtsc() - t0;
+  st->idlems = udiv64(cyclestons(idle), 1000000, 0);
+  st->upms = udiv64(nsuptime(), 1000000, 0);
+  st->halts = c->nhalts;
+  st->ticks = c->nticks;
+  st->nohz = c->nohz;
+  return 0;
+}
+
 // Give up the CPU for one scheduling round.
 void
 yield(void)
 {
   acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
+  setrunnable(myproc());
   sched();
   release(&ptable.lock);
 }
@@ -467,6 +1141,7 @@ forkret(void)
     first = 0;
     iinit(ROOTDEV);
     initlog(ROOTDEV);
+    swapinit(ROOTDEV);
   }
 
   // Return to "caller", actually trapret (see allocproc).
@@ -498,6 +1173,9 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  p->qstamp = rdtsc();
+  p->sleepnext = ptable.sleepq[SLEEPQ(chan)];
+  ptable.sleepq[SLEEPQ(chan)] = p;
 
   sched();
 
@@ -511,17 +1189,67 @@ sleep(void *chan, struct spinlock *lk)
   }
 }
 
+// Cycles a process must have slept for its wakeup to preempt
+// a running process of the same priority.
+#define WAKEGRAN 1000000
+
+// p has just been woken and queued. If it is queued on this CPU,
+// rather than leave it there until the running process's slice is
+// over, have an idle CPU steal it now, or else preempt the running
+// process if p has better priority or has slept longer than WAKEGRAN.
+// Caller holds ptable.lock.
+static void
+wakepreempt(struct proc *p, uint64 slept)
+{
+  struct cpu *o, *c = mycpu();
+  struct proc *cur = c->proc;
+
+  if(cur == 0 || p->rqcpu != c)
+    return;  // place() already saw to it.
+
+  for(o = cpus; o < &cpus[ncpu]; o++){
+    if(o->idle && canrun(p, o)){
+      kick(o);
+      return;
+    }
+  }
+  if(p->prio < cur->prio || (p->prio == cur->prio && slept > WAKEGRAN))
+    cur->resched = 1;
+}
+
 //PAGEBREAK!
 // Wake up all processes sleeping on chan.
 // The ptable lock must be held.
 static void
 wakeup1(void *chan)
 {
-  struct proc *p;
+  struct proc *p, **pp;
+  uint64 slept;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+  pp = &ptable.sleepq[SLEEPQ(chan)];
+  while((p = *pp) != 0){
+    if(p->chan != chan){
+      pp = &p->sleepnext;
+      continue;
+    }
+    *pp = p->sleepnext;
+    slept = rdtsc() - p->qstamp;
+    setrunnable(p);
+    wakepreempt(p, slept);
+  }
+}
+
+// Take sleeping p off its wait queue and make it runnable.
+// The ptable lock must be held.
+static void
+unsleep(struct proc *p)
+{
+  struct proc **pp;
+
+  for(pp = &ptable.sleepq[SLEEPQ(p->chan)]; *pp != p; pp = &(*pp)->sleepnext)
+    ;
+  *pp = p->sleepnext;
+  setrunnable(p);
 }
 
 // Wake up all processes sleeping on chan.
@@ -544,10 +1272,14 @@ kill(int pid)
   acquire(&ptable.lock);
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
     if(p->pid == pid){
+      if(p->kfn){
+        release(&ptable.lock);
+        return -1;
+      }
       p->killed = 1;
       // Wake process from sleep if necessary.
       if(p->state == SLEEPING)
-        p->state = RUNNABLE;
+        unsleep(p);
       release(&ptable.lock);
       return 0;
     }
@@ -556,6 +1288,270 @@ kill(int pid)
   return -1;
 }
 
+// Clock hand for reclaim(): a slot in the process table
+// and a user virtual address within that process.
+static struct {
+  int proc;
+  uint va;
+} hand;
+
+// Can reclaim() take pages away from p? Only if p cannot be using
+// them right now: p is the caller, or p was preempted in user mode
+// and is waiting to run, so no CPU has its TLB entries loaded and
+// no kernel code is halfway through touching its memory.
+// Caller holds ptable.lock.
+int
+reclaimable(struct proc *p)
+{
+  if(p->pgdir == 0)
+    return 0;
+  return p == myproc() || (p->state == RUNNABLE && p->inuser);
+}
+
+// What reclaim() can do with a user page.
+#define PG_NONE  0  // Nothing: leave it alone
+#define PG_ANON  1  // Anonymous memory: swap it out
+#define PG_FILE  2  // Page of a file mapping: drop it, after writing it back
+#define PG_TEXT  3  // Program text: drop it, textfault() reads it back
+
+// Classify the present user page at va, whose PTE is pte.
+// For PG_FILE, *rp is set to the mapping.
+static int
+pagekind(struct proc *p, uint va, pte_t pte, struct mmap_region **rp)
+{
+  struct mmap_region *r;
+
+  if(va < p->sz){
+    if(!(pte & PTE_W) && !(pte & PTE_COW) && findtext(p, va))
+      return PG_TEXT;
+    return PG_ANON;
+  }
+  for(r = p->mmap_regions; r < &p->mmap_regions[p->mmap_count]; r++){
+    if(va >= r->addr && va < r->addr + r->length){
+      if(r->file == 0)
+        return PG_ANON;
+      *rp = r;
+      return PG_FILE;
+    }
+  }
+  return PG_NONE;
+}
+
+// Advance the hand through p's page table to the next page to evict.
+// A page with PTE_A set gets a second chance: the bit is cleared and
+// the page skipped. Anonymous pages are only taken if anon is set
+// (there is a swap slot for them), and dirty file pages only if
+// dirty is set (the caller can write them back).
+// Returns the page's PTE and sets *kind and *rp, or returns 0
+// at the end of p.
+static pte_t*
+victim(struct proc *p, int anon, int dirty, int *kind, struct mmap_region **rp)
+{
+  pte_t *pte;
+
+  for(; hand.va < KERNBASE; hand.va += PGSIZE){
+    // Skip page tables shared since fork; the pages in them
+    // are the other processes' too.
+    if((pte = get_pte(p->pgdir, (void*)hand.va)) == 0 ||
+       ptshared(p->pgdir, hand.va)){
+      hand.va = PGADDR(PDX(hand.va) + 1, 0, 0) - PGSIZE;
+      continue;
+    }
+    if((*pte & (PTE_P|PTE_U)) != (PTE_P|PTE_U))
+      continue;
+    // A writable page mapped by more than one process is a shared
+    // wmap page; the others must keep seeing our writes.
+    if((*pte & PTE_W) && get_ref_count(PTE_ADDR(*pte)) > 1)
+      continue;
+    *kind = pagekind(p, hand.va, *pte, rp);
+    if(*kind == PG_NONE || (*kind == PG_ANON && !anon) ||
+       (*kind == PG_FILE && (*pte & PTE_D) && !dirty))
+      continue;
+    if(*pte & PTE_A){
+      *pte &= ~PTE_A;
+      continue;
+    }
+    return pte;
+  }
+  return 0;
+}
+
+// Write the page at pa back to offset off of ip, in chunks
+// small enough for one log transaction each (see filewrite).
+static int
+writeback(struct inode *ip, uint pa, uint off)
+{
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * 512;
+  int i, n, r;
+
+  for(i = 0; i < PGSIZE; i += n){
+    n = PGSIZE - i;
+    if(n > max)
+      n = max;
+    begin_op();
+    ilock(ip);
+    r = writei(ip, (char*)P2V(pa) + i, off + i, n);
+    iunlock(ip);
+    end_op();
+    if(r != n)
+      return -1;
+  }
+  return 0;
+}
+
+// Free a page of memory for kalloc(). Clean file-backed pages and
+// program text are cheapest, since they can simply be dropped and
+// read back on the next fault. Dirty file pages are written back
+// first; anonymous pages are swapped out. Either way the page must
+// have gone a full sweep of the hand without PTE_A being set.
+// Returns 1 if a page was freed, 0 if none could be. May sleep.
+int
+reclaim(void)
+{
+  struct proc *p;
+  struct mmap_region *r;
+  struct inode *ip;
+  pde_t *pgdir;
+  pte_t *pte;
+  uint pa, va, off;
+  int slot, n, kind, pid, dirty, err;
+
+  slot = swapalloc();
+  // Writing back takes the log and the inode lock, which
+  // the caller may already be holding (e.g. exec).
+  dirty = myproc()->nfsop == 0;
+
+  acquire(&ptable.lock);
+  // Two trips around the table, since the first
+  // may find nothing but recently used pages.
+  for(n = 0; n < 2*NPROC + 1; n++){
+    p = &ptable.proc[hand.proc];
+    while(reclaimable(p) && (pte = victim(p, slot >= 0, dirty, &kind, &r)) != 0){
+      pa = PTE_ADDR(*pte);
+      va = hand.va;
+      hand.va += PGSIZE;
+      if(kind == PG_ANON){
+        swapassign(slot, pa);
+        *pte = SWAPPTE(slot, *pte);
+        pageresident(p, va, -1);
+        if(p == myproc())
+          lcr3(V2P(p->pgdir));
+        release(&ptable.lock);
+        swapwrite(slot);
+        return 1;
+      }
+      if(kind == PG_FILE && (*pte & PTE_D)){
+        // Write it back with ptable.lock released, keeping the frame
+        // pinned. Clearing PTE_D first means a store made meanwhile
+        // shows up, and then the page stays.
+        *pte &= ~PTE_D;
+        if(p == myproc())
+          lcr3(V2P(p->pgdir));
+        inc_ref_count(pa);
+        ip = idup(r->file->ip);
+        off = va - r->base;
+        pid = p->pid;
+        pgdir = p->pgdir;
+        release(&ptable.lock);
+        err = writeback(ip, pa, off);
+        begin_op();
+        iput(ip);
+        end_op();
+        acquire(&ptable.lock);
+        kfree(P2V(pa));  // unpin
+        if(p->pid != pid || p->pgdir != pgdir || !reclaimable(p) ||
+           p != &ptable.proc[hand.proc])
+          break;
+        pte = get_pte(pgdir, (void*)va);
+        if(pte == 0 || (*pte & PTE_P) == 0 || PTE_ADDR(*pte) != pa)
+          continue;
+        if(err < 0){
+          *pte |= PTE_D;
+          continue;
+        }
+        if(*pte & (PTE_A|PTE_D))
+          continue;
+      }
+      *pte = 0;
+      pageresident(p, va, -1);
+      if(p == myproc())
+        lcr3(V2P(p->pgdir));
+      release(&ptable.lock);
+      if(slot >= 0)
+        swapcancel(slot);
+      kfree(P2V(pa));
+      return 1;
+    }
+    if(p == myproc())
+      lcr3(V2P(p->pgdir));  // victim() cleared PTE_A bits
+    hand.proc = (hand.proc + 1) % NPROC;
+    hand.va = 0;
+  }
+  release(&ptable.lock);
+  if(slot >= 0)
+    swapcancel(slot);
+  return 0;
+}
+
+// Clock hand for ksmscan().
+static struct {
+  int proc;
+  uint va;
+} ksmhand;
+
+// The first page at or after va in one of p's anonymous
+// MAP_MERGEABLE regions, or 0 if there is none.
+static uint
+nextmergeable(struct proc *p, uint va)
+{
+  struct mmap_region *r;
+  uint best = 0;
+
+  for(r = p->mmap_regions; r < &p->mmap_regions[p->mmap_count]; r++){
+    if(!(r->flags & MAP_MERGEABLE) || r->file != 0)
+      continue;
+    if(va >= r->addr + r->length)
+      continue;
+    if(va > r->addr){
+      best = PGROUNDDOWN(va);
+      break;
+    }
+    if(best == 0 || r->addr < best)
+      best = r->addr;
+  }
+  return best;
+}
+
+// Move ksmd's hand over up to n pages of mergeable regions,
+// handing each present page to ksmpage().
+void
+ksmscan(int n)
+{
+  struct proc *p;
+  pte_t *pte;
+  uint va;
+  int visits;
+
+  acquire(&ptable.lock);
+  for(visits = 0; n > 0 && visits < NPROC; ){
+    p = &ptable.proc[ksmhand.proc];
+    if(!reclaimable(p) || (va = nextmergeable(p, ksmhand.va)) == 0){
+      if(++ksmhand.proc == NPROC){
+        ksmhand.proc = 0;
+        ksmpass();
+      }
+      ksmhand.va = 0;
+      visits++;
+      continue;
+    }
+    if((pte = get_pte(p->pgdir, (void*)va)) != 0 && (*pte & PTE_P))
+      ksmpage(p, va, pte);
+    ksmhand.va = va + PGSIZE;
+    n--;
+  }
+  release(&ptable.lock);
+}
+
 //PAGEBREAK: 36
 // Print a process listing to console.  For debugging.
 // Runs when user types ^P on console.
@@ -583,7 +1579,10 @@ procdump(void)
       state = states[p->state];
     else
       state = "???";
-    cprintf("%d %s %s", p->pid, state, p->name);
+    if(p->kfn)
+      cprintf("%d %s %d [%s]", p->pid, state, p->prio, p->name);
+    else
+      cprintf("%d %s %d %s", p->pid, state, p->prio, p->name);
     if(p->state == SLEEPING){
       getcallerpcs((uint*)p->context->ebp+2, pc);
       for(i=0; i<10 && pc[i] != 0; i++)
@@ -639,6 +1638,11 @@ uint wmap(uint addr, int length, int flags, int fd) {
     p->mmap_regions[p->mmap_count].flags = flags;
     p->mmap_regions[p->mmap_count].fd = fd;
     p->mmap_regions[p->mmap_count].file = f;
+    p->mmap_regions[p->mmap_count].base = addr;
+    p->mmap_regions[p->mmap_count].prot = PROT_READ | PROT_WRITE;
+    p->mmap_regions[p->mmap_count].nloaded = 0;
+    p->mmap_regions[p->mmap_count].id = xadd(&nextmapid, 1);
+    p->mmap_regions[p->mmap_count].handler = p->pid;
 
     p->mmap_count++;
 
@@ -647,60 +1651,79 @@ uint wmap(uint addr, int length, int flags, int fd) {
 
 
 
-int wunmap(uint addr) {
-    struct proc *p = myproc();
-    int found = 0;
+// Remove p's map at index i, writing shared file pages back first.
+static int unmapregion(struct proc *p, int i) {
+    struct mmap_region *region = &p->mmap_regions[i];
+    struct file *f = region->file;
+    uint start_addr = region->addr;
+    uint end_addr = start_addr + region->length;
+    pte_t *pte;
 
-    for (int i = 0; i < p->mmap_count; i++) {
-        struct mmap_region *region = &p->mmap_regions[i];
-        if (region->addr == addr) {
-            if (region->file && (region->flags & MAP_SHARED)) {
-                for (uint offset = 0; offset < region->length; offset += PGSIZE) {
-                    char *page = uva2ka(p->pgdir, (char *)(addr + offset));
-                    if (page) {
-
-                        begin_op();
-                        ilock(region->file->ip);
-                        int bytes_written = writei(region->file->ip, page, offset, PGSIZE);
-                        iunlock(region->file->ip);
-                        if (bytes_written < 0) {
-                            return FAILED;
-                        }
-                        end_op();
-                    }
-                }
-            }
-            found = 1;
-
-            uint start_addr = region->addr;
-            uint end_addr = start_addr + region->length;
-
-            for (uint a = start_addr; a < end_addr; a += PGSIZE) {
-                pte_t *pte = get_pte(p->pgdir, (void*)a);
-                if (pte && (*pte & PTE_P)) {
-                    uint physical_address = PTE_ADDR(*pte);
-                    kfree(P2V(physical_address));
-                    *pte = 0;
-                }
+    if (f && (region->flags & MAP_SHARED)) {
+        for (uint a = start_addr; a < end_addr; a += PGSIZE) {
+            pte = get_pte(p->pgdir, (void *)a);
+            if (pte && (*pte & PTE_P) &&
+                writeback(f->ip, PTE_ADDR(*pte), a - region->base) < 0) {
+                return FAILED;
             }
+        }
+    }
 
-            lcr3(V2P(p->pgdir));
+    for (uint a = start_addr; a < end_addr; a += PGSIZE) {
+        pte = get_pte(p->pgdir, (void*)a);
+        if (pte && (*pte & PTE_P)) {
+            uint physical_address = PTE_ADDR(*pte);
+            kfree(P2V(physical_address));
+            *pte = 0;
+            p->mstat.rss--;
+        } else if (pte && (*pte & PTE_SWAP)) {
+            swapfree(*pte);
+            *pte = 0;
+        }
+    }
 
-            for (int j = i; j < p->mmap_count - 1; j++) {
-                p->mmap_regions[j] = p->mmap_regions[j + 1];
-            }
-            p->mmap_count--;
-            if (region->file) {
-                fileclose(region->file);
-            }
+    lcr3(V2P(p->pgdir));
+
+    for (int j = i; j < p->mmap_count - 1; j++) {
+        p->mmap_regions[j] = p->mmap_regions[j + 1];
+    }
+    p->mmap_count--;
+    if (f) {
+        fileclose(f);
+    }
+    return SUCCESS;
+}
+
+int wunmap(uint addr) {
+    struct proc *p = myproc();
+    uint base;
+    int i;
+
+    for (i = 0; i < p->mmap_count; i++) {
+        if (p->mmap_regions[i].addr == addr) {
             break;
         }
     }
+    if (i == p->mmap_count) {
+        return FAILED;
+    }
 
-    if (!found) {
+    base = p->mmap_regions[i].base;
+    if (unmapregion(p, i) < 0) {
         return FAILED;
     }
 
+    // Unmapping a whole map also removes the pieces wprotect() split off.
+    if (addr == base) {
+        for (i = 0; i < p->mmap_count; ) {
+            if (p->mmap_regions[i].base != base) {
+                i++;
+            } else if (unmapregion(p, i) < 0) {
+                return FAILED;
+            }
+        }
+    }
+
     return SUCCESS;
 }
 
@@ -715,16 +1738,7 @@ int getwmapinfo(struct wmapinfo *wminfo) {
     for (i = 0; i < curproc->mmap_count && i < MAX_WMMAP_INFO; i++) {
         wminfo->addr[i] = curproc->mmap_regions[i].addr;
         wminfo->length[i] = curproc->mmap_regions[i].length;
-
-        int pages_loaded = 0;
-        uint va;
-        for (va = wminfo->addr[i]; va < wminfo->addr[i] + wminfo->length[i]; va += PGSIZE) {
-            pte_t *pte = get_pte(curproc->pgdir, (void*)va);
-            if (pte && (*pte & PTE_P)) {
-                pages_loaded++;
-            }
-        }
-        wminfo->n_loaded_pages[i] = pages_loaded;
+        wminfo->n_loaded_pages[i] = curproc->mmap_regions[i].nloaded;
     }
 
     return SUCCESS;
@@ -732,6 +1746,56 @@ int getwmapinfo(struct wmapinfo *wminfo) {
 }
 
 
+// Account for the page at va of p becoming resident (n = 1)
+// or not (n = -1).
+void pageresident(struct proc *p, uint va, int n) {
+    struct mmap_region *r;
+
+    p->mstat.rss += n;
+    if ((r = findregion(p, va)) != 0)
+        r->nloaded += n;
+}
+
+static void addfaults(struct memstat *to, struct memstat *from) {
+    to->minflt += from->minflt;
+    to->majflt += from->majflt;
+    to->cowflt += from->cowflt;
+    to->zerofill += from->zerofill;
+    to->fileread += from->fileread;
+}
+
+// Fault and memory counts for process pid, or for the whole
+// system if pid is 0; the fault counts then include processes
+// that have exited.
+int getmemstat(int pid, struct memstat *st) {
+    struct proc *p;
+
+    acquire(&ptable.lock);
+    if (pid == 0) {
+        *st = ptable.reaped;
+        for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
+            if (p->state == UNUSED || p->state == EMBRYO)
+                continue;
+            addfaults(st, &p->mstat);
+            st->rss += p->mstat.rss;
+            st->ptpages += ptpages(p->pgdir);
+        }
+        release(&ptable.lock);
+        return SUCCESS;
+    }
+    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
+        if (p->pid == pid && p->state != UNUSED && p->state != EMBRYO) {
+            *st = p->mstat;
+            st->ptpages = ptpages(p->pgdir);
+            release(&ptable.lock);
+            return SUCCESS;
+        }
+    }
+    release(&ptable.lock);
+    return FAILED;
+}
+
+
 uint va2pa(uint va) 
 {
   struct proc *currproc = myproc();
@@ -747,3 +1811,324 @@ uint va2pa(uint va)
   uint pa = PTE_ADDR(*pte) | (va & 0xFFF); 
   return pa;
 }
+
+// Fill ents with what the current process has mapped at the n pages
+// starting at va, in batches so the user buffer is written with no
+// lock held. Returns the number of entries filled, or -1.
+int pagemap(uint va, int n, uint ents) {
+    pde_t *pgdir = myproc()->pgdir;
+    struct pagemapent batch[32], *e;
+    pte_t *pte;
+    int i, m;
+
+    va = PGROUNDDOWN(va);
+    if (n < 0 || va + (uint)n * PGSIZE < va || va + (uint)n * PGSIZE > KERNBASE)
+        return FAILED;
+    for (i = 0; i < n; i += m) {
+        m = n - i < NELEM(batch) ? n - i : NELEM(batch);
+        memset(batch, 0, sizeof(batch));
+        for (e = batch; e < &batch[m]; e++, va += PGSIZE) {
+            if ((pte = get_pte(pgdir, (void *)va)) == 0)
+                continue;
+            if (*pte & PTE_SWAP) {
+                e->pfn = SWAPSLOT(*pte);
+                e->flags = PM_SWAP;
+                continue;
+            }
+            if (!(*pte & PTE_P))
+                continue;
+            e->pfn = PTE_ADDR(*pte) >> PTXSHIFT;
+            e->flags = PM_PRESENT;
+            e->refs = get_ref_count(PTE_ADDR(*pte));
+            if (ptshared(pgdir, va)) {
+                // Shared along with its page table since fork: each
+                // other holder of the table also refers to the page.
+                e->refs += get_ref_count(PTE_ADDR(pgdir[PDX(va)])) - 1;
+                if (*pte & PTE_W)
+                    e->flags |= PM_COW;
+            } else if (*pte & PTE_W)
+                e->flags |= PM_WRITE;
+            if (*pte & PTE_A)
+                e->flags |= PM_ACCESSED;
+            if (*pte & PTE_D)
+                e->flags |= PM_DIRTY;
+            if (*pte & PTE_COW)
+                e->flags |= PM_COW;
+        }
+        if (copy_to_user(ents + i * sizeof(batch[0]), batch, m * sizeof(batch[0])) < 0)
+            return FAILED;
+    }
+    return n;
+}
+
+// Queue a fault by p at addr in a MAP_USERFAULT region and wait
+// for the region's handler to fill the page. Returns -1 if the queue
+// is full. Returns 0 once the page is there or p has been killed.
+int userfault(struct proc *p, uint addr) {
+    struct ufault *f;
+    struct mmap_region *r;
+
+    acquire(&uftable.lock);
+    for (f = uftable.fault; f < &uftable.fault[NUFAULT]; f++)
+        if (f->pid == 0)
+            break;
+    if (f == &uftable.fault[NUFAULT] || (r = findregion(p, addr)) == 0) {
+        release(&uftable.lock);
+        return -1;
+    }
+    f->pid = p->pid;
+    f->addr = addr;
+    f->handler = r->handler;
+    f->read = 0;
+    f->filled = 0;
+    wakeup(&uftable);
+    while (!f->filled && !p->killed)
+        sleep(f, &uftable.lock);
+    f->pid = 0;
+    release(&uftable.lock);
+    return 0;
+}
+
+// Wait for a fault in a map the caller handles that it has not
+// seen yet, and describe it.
+int wfault(struct wfaultinfo *info) {
+    struct ufault *f;
+    int me = myproc()->pid;
+
+    acquire(&uftable.lock);
+    for (;;) {
+        for (f = uftable.fault; f < &uftable.fault[NUFAULT]; f++)
+            if (f->pid && !f->read && f->handler == me)
+                break;
+        if (f < &uftable.fault[NUFAULT])
+            break;
+        if (myproc()->killed) {
+            release(&uftable.lock);
+            return FAILED;
+        }
+        sleep(&uftable, &uftable.lock);
+    }
+    f->read = 1;
+    info->pid = f->pid;
+    info->addr = f->addr;
+    release(&uftable.lock);
+    return SUCCESS;
+}
+
+// Map the frame pa at addr in p's MAP_USERFAULT region r, unless the
+// page is already there, which resolves the fault just as well.
+// A new mapping takes a reference to pa. Caller holds ptable.lock.
+static int ufmap(struct proc *p, struct mmap_region *r, uint addr, uint pa) {
+    pte_t *pte;
+
+    pte = get_pte(p->pgdir, (void *)addr);
+    if (pte && (*pte & (PTE_P | PTE_SWAP)))
+        return SUCCESS;
+    if (perform_mapping(p->pgdir, (void *)addr, PGSIZE, pa, regionperm(r)) < 0)
+        return FAILED;
+    inc_ref_count(pa);
+    pageresident(p, addr, 1);
+    return SUCCESS;
+}
+
+// The live process with the given pid, or 0. Caller holds ptable.lock.
+static struct proc *findproc(int pid) {
+    struct proc *p;
+
+    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+        if (p->pid == pid && p->state != UNUSED && p->state != ZOMBIE)
+            return p;
+    return 0;
+}
+
+// Resolve the fault by pid at addr, which wfault() has reported,
+// with a copy of the page at src. Other faults waiting at addr are
+// resolved with the same frame only if their process shares the
+// map with pid's, that is, holds a piece of the same wmap() through
+// fork; anyone else's fault waits for its own fill. Returns FAILED
+// if no such fault is waiting or the caller is not its handler.
+// The page is complete before any process can see it.
+int wfill(int pid, uint addr, char *src) {
+    struct proc *p, *q;
+    struct ufault *f, *g;
+    struct mmap_region *r, *qr;
+    char *mem;
+    int ok = FAILED, me = myproc()->pid;
+
+    if (addr % PGSIZE != 0)
+        return FAILED;
+    if ((mem = kalloc()) == 0)
+        return FAILED;
+    memmove(mem, src, PGSIZE);
+
+    acquire(&uftable.lock);
+    acquire(&ptable.lock);
+    for (f = uftable.fault; f < &uftable.fault[NUFAULT]; f++)
+        if (f->pid == pid && f->addr == addr && f->read && !f->filled &&
+            f->handler == me)
+            break;
+    if (f == &uftable.fault[NUFAULT] || (p = findproc(pid)) == 0 ||
+        (r = findregion(p, addr)) == 0 || !(r->flags & MAP_USERFAULT))
+        goto out;
+    if (ufmap(p, r, addr, V2P(mem)) < 0)
+        goto out;
+    ok = SUCCESS;
+    f->filled = 1;
+    wakeup1(f);
+
+    for (g = uftable.fault; g < &uftable.fault[NUFAULT]; g++) {
+        if (g->pid == 0 || g->filled || g->addr != addr || g->handler != me)
+            continue;
+        if ((q = findproc(g->pid)) == 0 || (qr = findregion(q, addr)) == 0 ||
+            qr->id != r->id || !(qr->flags & MAP_SHARED))
+            continue;
+        if (ufmap(q, qr, addr, V2P(mem)) == SUCCESS) {
+            g->filled = 1;
+            wakeup1(g);
+        }
+    }
+
+out:
+    release(&ptable.lock);
+    release(&uftable.lock);
+    kfree(mem);  // drop our own reference
+    return ok;
+}
+
+// Make pid the handler of the caller's MAP_USERFAULT map containing
+// addr, every piece of it, in place of the process that made it.
+// Faults already queued keep the handler they were queued for.
+int wfhandler(uint addr, int pid) {
+    struct proc *p = myproc();
+    struct mmap_region *r, *m;
+
+    if ((m = findregion(p, addr)) == 0 || !(m->flags & MAP_USERFAULT))
+        return FAILED;
+    acquire(&ptable.lock);
+    if (findproc(pid) == 0) {
+        release(&ptable.lock);
+        return FAILED;
+    }
+    release(&ptable.lock);
+    for (r = p->mmap_regions; r < &p->mmap_regions[p->mmap_count]; r++)
+        if (r->id == m->id)
+            r->handler = pid;
+    return SUCCESS;
+}
+
+// The map of p containing va, or 0.
+struct mmap_region *findregion(struct proc *p, uint va) {
+    struct mmap_region *r;
+
+    for (r = p->mmap_regions; r < &p->mmap_regions[p->mmap_count]; r++)
+        if (va >= r->addr && va < r->addr + r->length)
+            return r;
+    return 0;
+}
+
+// PTE permission bits for a page of r. A PROT_NONE page keeps PTE_P
+// but loses PTE_U, like the guard page below the user stack.
+uint regionperm(struct mmap_region *r) {
+    if (r->prot == PROT_NONE)
+        return 0;
+    if (r->prot & PROT_WRITE)
+        return PTE_W | PTE_U;
+    return PTE_U;
+}
+
+// Does r's protection allow a read, or a write if write is set?
+int regionallows(struct mmap_region *r, int write) {
+    if (r->prot == PROT_NONE)
+        return 0;
+    return !write || (r->prot & PROT_WRITE);
+}
+
+// Split p's map r at at, which must lie strictly inside it.
+static int splitregion(struct proc *p, struct mmap_region *r, uint at) {
+    struct mmap_region *n;
+
+    if (p->mmap_count >= MAX_WMMAP_INFO)
+        return FAILED;
+    n = &p->mmap_regions[p->mmap_count++];
+    *n = *r;
+    n->addr = at;
+    n->length = r->addr + r->length - at;
+    r->length = at - r->addr;
+    n->nloaded = resident(p->pgdir, n->addr, n->addr + n->length);
+    r->nloaded -= n->nloaded;
+    if (n->file)
+        filedup(n->file);
+    return SUCCESS;
+}
+
+// Join pieces of one map that are next to each other and have
+// the same protection again.
+static void joinregions(struct proc *p) {
+    struct mmap_region *r, *n;
+    int j;
+
+again:
+    for (r = p->mmap_regions; r < &p->mmap_regions[p->mmap_count]; r++) {
+        for (n = p->mmap_regions; n < &p->mmap_regions[p->mmap_count]; n++) {
+            if (n->base != r->base || n->prot != r->prot || n->addr != r->addr + r->length)
+                continue;
+            r->length += n->length;
+            r->nloaded += n->nloaded;
+            if (n->file)
+                fileclose(n->file);
+            for (j = n - p->mmap_regions; j < p->mmap_count - 1; j++)
+                p->mmap_regions[j] = p->mmap_regions[j + 1];
+            p->mmap_count--;
+            goto again;
+        }
+    }
+}
+
+// Set the protection of the pages in [addr, addr+length), which must
+// be covered by maps. Maps are split where the range starts or ends
+// inside them, so pages faulted in later get the new protection, and
+// the PTEs already there are rewritten with a single TLB flush.
+// A COW page stays read-only; the COW fault makes it writable.
+int wprotect(uint addr, int length, int prot) {
+    struct proc *p = myproc();
+    struct mmap_region *r;
+    uint a, end, perm;
+    pte_t *pte;
+
+    if (addr % PGSIZE != 0 || length <= 0 || (prot & ~(PROT_READ | PROT_WRITE)))
+        return FAILED;
+    end = PGROUNDUP(addr + length);
+    if (end < addr)
+        return FAILED;
+
+    // Check the whole range is mapped before changing anything.
+    for (a = addr; a < end; a = r->addr + r->length)
+        if ((r = findregion(p, a)) == 0)
+            return FAILED;
+
+    if ((r = findregion(p, addr)) != 0 && r->addr < addr && splitregion(p, r, addr) < 0)
+        return FAILED;
+    if ((r = findregion(p, end - 1)) != 0 && r->addr + r->length > end &&
+        splitregion(p, r, end) < 0) {
+        joinregions(p);
+        return FAILED;
+    }
+
+    for (a = addr; a < end; a = r->addr + r->length) {
+        r = findregion(p, a);
+        r->prot = prot;
+        perm = regionperm(r);
+        for (; a < r->addr + r->length; a += PGSIZE) {
+            if ((pte = get_pte(p->pgdir, (void *)a)) == 0 || !(*pte & (PTE_P | PTE_SWAP)))
+                continue;
+            if (*pte & PTE_COW)
+                *pte = (*pte & ~PTE_U) | (perm & PTE_U);
+            else
+                *pte = (*pte & ~(PTE_W | PTE_U)) | perm;
+        }
+    }
+    lcr3(V2P(p->pgdir));
+
+    joinregions(p);
+    return SUCCESS;
+}
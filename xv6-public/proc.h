@@ -1,7 +1,27 @@
 #include "wmap.h"
+#include "memstat.h"
+#include "sched.h"
+
+// Scheduling priorities. A process runs only when nothing
+// with a lower number is runnable. User processes move between
+// the NMLFQ levels from PRIO_USER down (see schedtick).
+#define PRIO_KERN  0                  // Kernel threads others may wait on
+#define PRIO_USER  1                  // Top MLFQ level
+#define PRIO_IDLE  (PRIO_USER+NMLFQ)  // Background kernel threads
+#define NPRIO      (PRIO_IDLE+1)
+
+// Runnable processes waiting for a CPU, one FIFO per priority.
+// Each has its own lock (see rqlock in proc.c).
+struct runq {
+  struct proc *head[NPRIO];
+  struct proc *tail[NPRIO];
+  volatile int n;              // Processes queued; idle CPUs peek at it
+  volatile uint prios;         // Bit i set if head[i] is not empty
+};
 
 // Per-CPU state
 struct cpu {
+  struct cpu *self;            // At %gs:0 (see mycpu)
   uchar apicid;                // Local APIC ID
   struct context *scheduler;   // swtch() here to enter scheduler
   struct taskstate ts;         // Used by x86 to find stack for interrupt
@@ -10,9 +30,20 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  struct faulthist fhist;      // Page fault latencies (see pagefault)
+  struct runq rq;              // Processes queued to run here
+  volatile int idle;           // In scheduler() looking for work
+  volatile int kicked;         // Work was queued for it while idle
+  uint64 nexttick;             // TSC value at the next clock tick
+  int nohz;                    // Clock tick stopped while idle
+  uint nticks;                 // Clock ticks taken
+  uint nhalts;                 // Times halted for lack of work
+  uint64 idlecycles;           // Time spent halted
+  volatile uint64 idlestart;   // When it halted, 0 if running
 };
 
 extern struct cpu cpus[NCPU];
+#define ALLCPUS ((1 << NCPU) - 1)  // Affinity mask with every CPU
 extern int ncpu;
 
 //PAGEBREAK: 17
@@ -36,12 +67,38 @@ struct context {
 
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// A read-only segment of the running program, so that
+// reclaim() can drop its pages and textfault() read them back.
+#define NTEXTSEG 3
+struct textseg {
+  uint va;      // Page-aligned start
+  uint off;     // Offset in the executable
+  uint filesz;  // Bytes loaded from the executable
+};
+
+// A program image built by loadimage(), not yet any process's.
+struct image {
+  pde_t *pgdir;
+  uint sz;
+  uint entry;         // Initial eip
+  uint sp;            // Initial esp, with argc and argv pushed
+  struct inode *exe;
+  struct textseg text[NTEXTSEG];
+  int ntext;
+  char name[16];
+};
+
 struct mmap_region {
   uint addr;
   int length;
   int flags;
   int fd;
   struct file *file;
+  uint base;  // addr passed to wmap(); wprotect() may split a map
+  int prot;   // PROT_ bits
+  int nloaded;  // Pages present (see pageresident)
+  uint id;      // Same for every piece of one wmap(), through fork too
+  int handler;  // Pid that may wfault()/wfill() for a MAP_USERFAULT map
 };
 
 
@@ -56,18 +113,55 @@ struct proc {
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
+  struct proc *sleepnext;      // Next on chan's wait queue
   int killed;                  // If non-zero, have been killed
+  int prio;                    // Scheduling priority (PRIO_*)
+  int pinned;                  // prio set by setpriority(), not MLFQ
+  int slice;                   // Ticks used at this MLFQ level
+  struct cpu *rqcpu;           // CPU whose run queue it is or was last on
+  uint affinity;               // CPUs it may run on, bit i for cpus[i]
+  int lastcpu;                 // Index in cpus[] it last ran on, or -1
+  struct proc *rqnext;         // Next in its run queue
+  int onrq;                    // On rqcpu's run queue, not yet picked
+  uint64 qstamp;               // When it was queued or went to sleep (rdtsc)
+  int resched;                 // Give up the CPU on return from trap
+  uint64 waitsum;              // Total cycles spent queued
+  struct schedstat sstat;      // Scheduling counts (see getschedstats)
+  int inuser;                  // Preempted in user mode (see reclaim)
+  int nfsop;                   // Depth of begin_op() calls (see reclaim)
+  void (*kfn)(void*);          // Kernel thread function (see kthread_create)
+  void *karg;                  // Argument to kfn
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
+  struct inode *exe;           // Executable, for reading back text
+  struct textseg text[NTEXTSEG]; // Read-only segments of exe
+  int ntext;
   char name[16];               // Process name (debugging)
   struct mmap_region mmap_regions[MAX_WMMAP_INFO];
   int mmap_count;
+  struct memstat mstat;        // Fault counts and rss (ptpages unused)
 };
 
 uint wmap(uint addr, int length, int flags, int fd); 
 int wunmap(uint addr); 
 int getwmapinfo(struct wmapinfo *wminfo); 
+int getmemstat(int pid, struct memstat *st);
+int setpriority(int pid, int level);
+int setaffinity(int pid, uint mask);
+int getaffinity(int pid);
+int getschedstats(int pid, struct schedstat *st);
+int getcpustat(int cpu, struct cpustat *st);
+void pageresident(struct proc *p, uint va, int n);
 uint va2pa(uint va);
+int pagemap(uint va, int n, uint ents);
+int userfault(struct proc *p, uint addr);
+int wfault(struct wfaultinfo *info);
+int wfill(int pid, uint addr, char *src);
+int wfhandler(uint addr, int pid);
+int wprotect(uint addr, int length, int prot);
+struct mmap_region *findregion(struct proc *p, uint va);
+uint regionperm(struct mmap_region *r);
+int regionallows(struct mmap_region *r, int write);
 
 // Process memory is laid out contiguously, low addresses first:
 //   text
@@ -0,0 +1,26 @@
+#ifndef SCHED_H
+#define SCHED_H
+// MLFQ levels for user processes, 0 runs first (see proc.c)
+#define NMLFQ 3
+
+// for `getschedstats`
+struct schedstat {
+    int level;     // MLFQ level, or -1 for a kernel thread
+    int pinned;    // Level fixed by setpriority()
+    uint nsched;   // Times taken off a run queue to run
+    uint ticks;    // Timer ticks spent running
+    uint avgwait;  // Average cycles queued before running
+    uint maxwait;  // Longest such wait
+    int cpu;       // CPU it last ran on, or -1
+    uint migrations; // Times it ran on a different CPU than before
+};
+
+// for `getcpustat`
+struct cpustat {
+    uint idlems;   // Milliseconds halted with nothing to run
+    uint upms;     // Milliseconds since boot
+    uint halts;    // Times it halted
+    uint ticks;    // Clock ticks it took
+    int nohz;      // Its tick is stopped right now
+};
+#endif
@@ -0,0 +1,151 @@
+// Scheduler throughput and wakeup latency.
+//
+// schedbench [nworkers]
+// Throughput: nworkers CPU-bound children (default 8) count
+// loops for NTICKS ticks, allowed on the first 1, 2, 4, ... CPUs
+// in turn up to all of them, so that one boot (make qemu CPUS=8)
+// shows how the scheduler scales. Each run also reports how
+// often the ptable and run queue locks had to be waited for.
+// Latency: two processes bounce a time stamp over a pair of
+// pipes; each hop is timed from the write until the reader
+// returns from read. It runs once alone and once next to a
+// CPU-bound process, which each woken reader has to preempt.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "sched.h"
+#include "lockstat.h"
+
+#define NTICKS 100
+#define SPIN   100000
+#define NROUND 1024   // a power of two: no 64-bit division here
+
+static uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
+struct lockstat st[NLOCKSTAT];
+
+// Times the lock called name had to be waited for since
+// lockstat was turned on.
+uint
+contended(char *name)
+{
+  int i, n;
+
+  n = lockstat(LS_READ, st, NLOCKSTAT);
+  for(i = 0; i < n; i++)
+    if(strcmp(st[i].name, name) == 0)
+      return st[i].contended;
+  return 0;
+}
+
+// Run nworkers on the first ncpu CPUs.
+void
+throughput(int nworkers, int ncpu)
+{
+  int i, p[2];
+  uint n, total, end;
+  volatile uint x;
+
+  if(pipe(p) < 0){
+    printf(2, "schedbench: pipe failed\n");
+    return;
+  }
+  lockstat(LS_ON, 0, 0);
+  end = uptime() + NTICKS;
+  for(i = 0; i < nworkers; i++){
+    if(fork() == 0){
+      close(p[0]);
+      setaffinity(getpid(), (1 << ncpu) - 1);
+      for(n = 0; uptime() < end; n++)
+        for(x = 0; x < SPIN; x++)
+          ;
+      write(p[1], &n, sizeof(n));
+      exit();
+    }
+  }
+  close(p[1]);
+  total = 0;
+  while(read(p[0], &n, sizeof(n)) == sizeof(n))
+    total += n;
+  close(p[0]);
+  for(i = 0; i < nworkers; i++)
+    wait();
+  printf(1, "%d workers on %d cpus: %d loops in %d ticks, "
+         "ptable waits %d, runq waits %d\n", nworkers, ncpu, total,
+         NTICKS, contended("ptable"), contended("runq"));
+  lockstat(LS_OFF, 0, 0);
+}
+
+void
+latency(int busy)
+{
+  int i, ping[2], pong[2], spinner;
+  uint64 t, total;
+
+  if(pipe(ping) < 0 || pipe(pong) < 0){
+    printf(2, "schedbench: pipe failed\n");
+    return;
+  }
+  spinner = -1;
+  if(busy && (spinner = fork()) == 0)
+    for(;;)
+      ;
+  if(fork() == 0){
+    total = 0;
+    for(i = 0; i < NROUND; i++){
+      if(read(ping[0], &t, sizeof(t)) != sizeof(t))
+        break;
+      total += rdtsc() - t;
+      t = rdtsc();
+      write(pong[1], &t, sizeof(t));
+    }
+    write(pong[1], &total, sizeof(total));
+    exit();
+  }
+  total = 0;
+  for(i = 0; i < NROUND; i++){
+    t = rdtsc();
+    write(ping[1], &t, sizeof(t));
+    if(read(pong[0], &t, sizeof(t)) != sizeof(t))
+      break;
+    total += rdtsc() - t;
+  }
+  read(pong[0], &t, sizeof(t));
+  total += t;
+  wait();
+  if(spinner > 0){
+    kill(spinner);
+    wait();
+  }
+  close(ping[0]);
+  close(ping[1]);
+  close(pong[0]);
+  close(pong[1]);
+  // 2*NROUND hops
+  printf(1, "pipe ping-pong%s: %d cycles/hop\n", busy ? ", cpu busy" : "",
+         (uint)(total >> 11));
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpustat cs;
+  int nworkers, ncpu, n;
+
+  nworkers = argc > 1 ? atoi(argv[1]) : 8;
+  for(ncpu = 0; getcpustat(ncpu, &cs) == 0; ncpu++)
+    ;
+  for(n = 1; n < ncpu; n *= 2)
+    throughput(nworkers, n);
+  throughput(nworkers, ncpu);
+  latency(0);
+  latency(1);
+  exit();
+}
@@ -3,6 +3,7 @@
 #include "types.h"
 #include "user.h"
 #include "fcntl.h"
+#include "spawn.h"
 
 // Parsed command representation
 #define EXEC  1
@@ -52,6 +53,7 @@ struct backcmd {
 int fork1(void);  // Fork but panics on failure.
 void panic(char*);
 struct cmd *parsecmd(char*);
+void freecmd(struct cmd*);
 
 // Execute cmd.  Never returns.
 void
@@ -130,6 +132,89 @@ runcmd(struct cmd *cmd)
   exit();
 }
 
+// Can spawncmd() run cmd, with n descriptor actions already
+// set up for it? Only commands, redirections and pipes can be
+// run without a copy of the shell to hold their state.
+int
+canspawn(struct cmd *cmd, int n)
+{
+  struct pipecmd *pcmd;
+
+  switch(cmd->type){
+  case EXEC:
+    return n < MAXSPAWNFA;
+  case REDIR:
+    return canspawn(((struct redircmd*)cmd)->cmd, n+2);
+  case PIPE:
+    pcmd = (struct pipecmd*)cmd;
+    return canspawn(pcmd->left, n+3) && canspawn(pcmd->right, n+3);
+  }
+  return 0;
+}
+
+// Start cmd with spawn() instead of forking the shell. The
+// shell opens the files and pipes itself, and fa[0..nfa-1]
+// tells each child which of them to use. Returns the number
+// of processes started, for the caller to wait for.
+int
+spawncmd(struct cmd *cmd, struct spawnfa *fa, int nfa)
+{
+  int n, fd, p[2];
+  struct execcmd *ecmd;
+  struct pipecmd *pcmd;
+  struct redircmd *rcmd;
+
+  switch(cmd->type){
+  default:
+    panic("spawncmd");
+
+  case EXEC:
+    ecmd = (struct execcmd*)cmd;
+    if(ecmd->argv[0] == 0)
+      return 0;
+    fa[nfa].fd = -1;
+    if(spawn(ecmd->argv[0], ecmd->argv, fa) < 0){
+      printf(2, "exec %s failed\n", ecmd->argv[0]);
+      return 0;
+    }
+    return 1;
+
+  case REDIR:
+    rcmd = (struct redircmd*)cmd;
+    if((fd = open(rcmd->file, rcmd->mode)) < 0){
+      printf(2, "open %s failed\n", rcmd->file);
+      return 0;
+    }
+    fa[nfa].fd = rcmd->fd;
+    fa[nfa].src = fd;
+    fa[nfa+1].fd = fd;
+    fa[nfa+1].src = -1;
+    n = spawncmd(rcmd->cmd, fa, nfa+2);
+    close(fd);
+    return n;
+
+  case PIPE:
+    pcmd = (struct pipecmd*)cmd;
+    if(pipe(p) < 0){
+      printf(2, "pipe failed\n");
+      return 0;
+    }
+    fa[nfa].fd = 1;
+    fa[nfa].src = p[1];
+    fa[nfa+1].fd = p[0];
+    fa[nfa+1].src = -1;
+    fa[nfa+2].fd = p[1];
+    fa[nfa+2].src = -1;
+    n = spawncmd(pcmd->left, fa, nfa+3);
+    fa[nfa].fd = 0;
+    fa[nfa].src = p[0];
+    n += spawncmd(pcmd->right, fa, nfa+3);
+    close(p[0]);
+    close(p[1]);
+    return n;
+  }
+}
+
 int
 getcmd(char *buf, int nbuf)
 {
@@ -145,7 +230,9 @@ int
 main(void)
 {
   static char buf[100];
-  int fd;
+  static struct spawnfa fa[MAXSPAWNFA];
+  struct cmd *cmd;
+  int fd, n;
 
   // Ensure that three file descriptors are open.
   while((fd = open("console", O_RDWR)) >= 0){
@@ -164,9 +251,17 @@ main(void)
         printf(2, "cannot cd %s\n", buf+3);
       continue;
     }
-    if(fork1() == 0)
-      runcmd(parsecmd(buf));
-    wait();
+    if((cmd = parsecmd(buf)) == 0)
+      continue;
+    if(canspawn(cmd, 0)){
+      for(n = spawncmd(cmd, fa, 0); n > 0; n--)
+        wait();
+    } else {
+      if(fork1() == 0)
+        runcmd(cmd);
+      wait();
+    }
+    freecmd(cmd);
   }
   exit();
 }
@@ -324,18 +419,36 @@ struct cmd *parsepipe(char**, char*);
 struct cmd *parseexec(char**, char*);
 struct cmd *nulterminate(struct cmd*);
 
+// The shell parses commands itself, so a syntax error must not
+// exit; the parser notes the first one here and carries on.
+char *parseerr;
+
+void
+syntax(char *msg)
+{
+  if(parseerr == 0)
+    parseerr = msg;
+}
+
+// Returns 0 after printing a message if s does not parse.
 struct cmd*
 parsecmd(char *s)
 {
   char *es;
   struct cmd *cmd;
 
+  parseerr = 0;
   es = s + strlen(s);
   cmd = parseline(&s, es);
   peek(&s, es, "");
-  if(s != es){
+  if(s != es && parseerr == 0){
     printf(2, "leftovers: %s\n", s);
-    panic("syntax");
+    syntax("syntax");
+  }
+  if(parseerr){
+    printf(2, "%s\n", parseerr);
+    freecmd(cmd);
+    return 0;
   }
   nulterminate(cmd);
   return cmd;
@@ -379,8 +492,10 @@ parseredirs(struct cmd *cmd, char **ps, char *es)
 
   while(peek(ps, es, "<>")){
     tok = gettoken(ps, es, 0, 0);
-    if(gettoken(ps, es, &q, &eq) != 'a')
-      panic("missing file for redirection");
+    if(gettoken(ps, es, &q, &eq) != 'a'){
+      syntax("missing file for redirection");
+      break;
+    }
     switch(tok){
     case '<':
       cmd = redircmd(cmd, q, eq, O_RDONLY, 0);
@@ -405,8 +520,10 @@ parseblock(char **ps, char *es)
     panic("parseblock");
   gettoken(ps, es, 0, 0);
   cmd = parseline(ps, es);
-  if(!peek(ps, es, ")"))
-    panic("syntax - missing )");
+  if(!peek(ps, es, ")")){
+    syntax("syntax - missing )");
+    return cmd;
+  }
   gettoken(ps, es, 0, 0);
   cmd = parseredirs(cmd, ps, es);
   return cmd;
@@ -431,13 +548,17 @@ parseexec(char **ps, char *es)
   while(!peek(ps, es, "|)&;")){
     if((tok=gettoken(ps, es, &q, &eq)) == 0)
       break;
-    if(tok != 'a')
-      panic("syntax");
+    if(tok != 'a'){
+      syntax("syntax");
+      break;
+    }
+    if(argc + 1 >= MAXARGS){
+      syntax("too many args");
+      break;
+    }
     cmd->argv[argc] = q;
     cmd->eargv[argc] = eq;
     argc++;
-    if(argc >= MAXARGS)
-      panic("too many args");
     ret = parseredirs(ret, ps, es);
   }
   cmd->argv[argc] = 0;
@@ -491,3 +612,40 @@ nulterminate(struct cmd *cmd)
   }
   return cmd;
 }
+
+void
+freecmd(struct cmd *cmd)
+{
+  struct backcmd *bcmd;
+  struct listcmd *lcmd;
+  struct pipecmd *pcmd;
+  struct redircmd *rcmd;
+
+  if(cmd == 0)
+    return;
+
+  switch(cmd->type){
+  case REDIR:
+    rcmd = (struct redircmd*)cmd;
+    freecmd(rcmd->cmd);
+    break;
+
+  case PIPE:
+    pcmd = (struct pipecmd*)cmd;
+    freecmd(pcmd->left);
+    freecmd(pcmd->right);
+    break;
+
+  case LIST:
+    lcmd = (struct listcmd*)cmd;
+    freecmd(lcmd->left);
+    freecmd(lcmd->right);
+    break;
+
+  case BACK:
+    bcmd = (struct backcmd*)cmd;
+    freecmd(bcmd->cmd);
+    break;
+  }
+  free(cmd);
+}
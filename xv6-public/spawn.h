@@ -0,0 +1,10 @@
+#ifndef SPAWN_H
+#define SPAWN_H
+// for `spawn`: changes to the child's copy of the caller's open
+// files, applied in order. The list ends at an entry with fd < 0.
+#define MAXSPAWNFA 32
+struct spawnfa {
+    int fd;   // Child's descriptor to set
+    int src;  // Caller's descriptor to dup into it, or -1 to close it
+};
+#endif
@@ -8,13 +8,48 @@
 #include "mmu.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "lockstat.h"
+
+#define NLOCK     128  // locks lockstat can follow
+#define SPINDELAY  16  // pauses per waiter ahead of us
+
+extern char end[];  // first address after kernel loaded from ELF file
+
+// Locks in the kernel image, for lockstat. Those are all set up
+// at boot, by one CPU; locks in allocated memory (pipes) come
+// and go, and are not followed. Each lock belongs to the class
+// of locks with its name, which is what lockstat reports on.
+struct {
+  volatile int on;
+  struct spinlock *lock[NLOCK];
+  int class[NLOCK];
+  int nlock;
+  char *name[NLOCKSTAT];  // of each class
+  int nclass;
+} locks;
 
 void
 initlock(struct spinlock *lk, char *name)
 {
+  int i;
+
   lk->name = name;
-  lk->locked = 0;
+  lk->next = 0;
+  lk->owner = 0;
   lk->cpu = 0;
+  lk->held = 0;
+  if((char*)lk >= end || locks.nlock == NLOCK)
+    return;
+  for(i = 0; i < locks.nclass; i++)
+    if(strncmp(locks.name[i], name, sizeof(((struct lockstat*)0)->name)) == 0)
+      break;
+  if(i == locks.nclass){
+    if(i == NLOCKSTAT)
+      return;
+    locks.name[locks.nclass++] = name;
+  }
+  locks.class[locks.nlock] = i;
+  locks.lock[locks.nlock++] = lk;
 }
 
 // Acquire the lock.
@@ -24,13 +59,26 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint t, ahead;
+  uint64 t0;
+  int contended;
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // The xchg is atomic.
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  // Take a ticket; the xadd is atomic. Then wait for our turn
+  // only reading the lock, and backing off in proportion to
+  // the waiters ahead of us, rather than all writing its cache
+  // line at once.
+  t = xadd(&lk->next, 1);
+  t0 = 0;
+  contended = lk->owner != t;
+  if(contended && locks.on)
+    t0 = rdtsc();
+  while((ahead = t - lk->owner) != 0)
+    for(ahead *= SPINDELAY; ahead > 0; ahead--)
+      pause();
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -39,18 +87,34 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for debugging.
   lk->cpu = mycpu();
-  getcallerpcs(&lk, lk->pcs);
+
+  if(locks.on){
+    lk->nacquire++;
+    if(contended){
+      lk->ncontended++;
+      if(t0)
+        lk->spin += rdtsc() - t0;
+    }
+    lk->held = rdtsc();
+  }
 }
 
 // Release the lock.
 void
 release(struct spinlock *lk)
 {
+  uint64 d;
+
   if(!holding(lk))
     panic("release");
 
-  lk->pcs[0] = 0;
   lk->cpu = 0;
+  if(lk->held){
+    d = rdtsc() - lk->held;
+    if(d > lk->maxhold)
+      lk->maxhold = d >> 32 ? 0xFFFFFFFF : d;
+    lk->held = 0;
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that all the stores in the critical
@@ -59,14 +123,65 @@ release(struct spinlock *lk)
   // stores; __sync_synchronize() tells them both not to.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code can't use a C assignment, since it might
-  // not be atomic. A real OS would use C atomics here.
-  asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+  // Hand the lock to the next ticket. Only the holder writes
+  // owner, so this need not be atomic, just a single store.
+  lk->owner = lk->owner + 1;
 
   popcli();
 }
 
+// Start (on) or stop counting lock statistics. Starting
+// clears the counts. A lock being held meanwhile may lose an
+// update; these are statistics.
+void
+lockstatctl(int on)
+{
+  struct spinlock *lk;
+  int i;
+
+  locks.on = 0;
+  if(!on)
+    return;
+  for(i = 0; i < locks.nlock; i++){
+    lk = locks.lock[i];
+    lk->nacquire = 0;
+    lk->ncontended = 0;
+    lk->spin = 0;
+    lk->maxhold = 0;
+  }
+  __sync_synchronize();
+  locks.on = 1;
+}
+
+// Sum the counts of the locks in class i.
+// Returns -1 if there is no such class.
+int
+getlockstat(int i, struct lockstat *st)
+{
+  struct spinlock *lk;
+  uint64 spin;
+  int j;
+
+  if(i < 0 || i >= locks.nclass)
+    return -1;
+  memset(st, 0, sizeof(*st));
+  safestrcpy(st->name, locks.name[i], sizeof(st->name));
+  spin = 0;
+  for(j = 0; j < locks.nlock; j++){
+    if(locks.class[j] != i)
+      continue;
+    lk = locks.lock[j];
+    st->nlocks++;
+    st->acquires += lk->nacquire;
+    st->contended += lk->ncontended;
+    spin += lk->spin;
+    if(lk->maxhold > st->maxhold)
+      st->maxhold = lk->maxhold;
+  }
+  st->spin = spin >> 10;
+  return 0;
+}
+
 // Record the current call stack in pcs[] by following the %ebp chain.
 void
 getcallerpcs(void *v, uint pcs[])
@@ -91,7 +206,7 @@ holding(struct spinlock *lock)
 {
   int r;
   pushcli();
-  r = lock->locked && lock->cpu == mycpu();
+  r = lock->owner != lock->next && lock->cpu == mycpu();
   popcli();
   return r;
 }
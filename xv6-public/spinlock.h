@@ -1,11 +1,19 @@
 // Mutual exclusion lock.
+// A ticket lock: acquire() takes the next ticket and waits
+// until owner reaches it, so CPUs get the lock in the order
+// they asked for it.
 struct spinlock {
-  uint locked;       // Is the lock held?
+  volatile uint next;   // Next ticket to hand out
+  volatile uint owner;  // Ticket holding the lock
 
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
-  uint pcs[10];      // The call stack (an array of program counters)
-                     // that locked the lock.
-};
 
+  // Counted only while lockstat is on (see lockstatctl).
+  uint nacquire;     // Acquisitions
+  uint ncontended;   // that had to wait for another CPU
+  uint64 spin;       // Cycles spent waiting
+  uint64 held;       // When it was acquired, 0 if not counting
+  uint maxhold;      // Longest hold, in cycles
+};
@@ -0,0 +1,308 @@
+// Swap area for anonymous user pages.
+//
+// The swap area is SWAPBLOCKS blocks on the root disk, just past the
+// file system (see mkfs.c), carved into page-sized slots. When kalloc()
+// runs out of memory, reclaim() in proc.c picks a cold page, and the
+// page's PTE is replaced by a swap entry (see SWAPPTE in mmu.h): PTE_P
+// clear, PTE_SWAP set, and the slot number in the address bits. The
+// page fault handler calls swapin() to bring it back.
+//
+// Slots are reference counted by the PTEs that name them, so fork()
+// can share a swapped-out page by copying the swap entry. Each side
+// gets its own frame when it faults the page back in, which is the
+// same thing a COW break would have given it.
+//
+// While a slot is being written out (busy), it still owns the frame
+// in pa. If the owner faults on the page before the write finishes,
+// swapin() takes the frame back instead of waiting for the disk.
+//
+// A slot's page may instead be kept compressed in memory (zlen != 0,
+// see zswap.c), in which case its disk blocks go unused.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "buf.h"
+#include "swap.h"
+#include "wmap.h"
+
+#define NSWAPSLOT (SWAPBLOCKS / (PGSIZE / BSIZE))
+
+struct swapslot {
+  int ref;    // Number of PTEs naming this slot
+  int busy;   // Being written out
+  uint pa;    // Frame still holding the page while busy
+  uint zh;    // Compressed page in the pool (see zput)
+  int zlen;   // Its length, 0 if the page is on disk
+};
+
+struct {
+  struct spinlock lock;
+  struct swapslot slot[NSWAPSLOT];
+  uint start;      // first block of the swap area
+  int nslot;       // 0 until swapinit()
+  uint nswapin;
+  uint nswapout;
+  uint nzin;
+  uint nzout;
+  uint64 incycles;   // time spent in swapin(), from disk
+  uint64 zincycles;  // and from the pool
+  struct buf buf;  // for swaprw(); its sleeplock serializes swap I/O
+} swap;
+
+void
+swapinit(int dev)
+{
+  struct superblock sb;
+
+  initlock(&swap.lock, "swap");
+  zswapinit();
+  initsleeplock(&swap.buf.lock, "swapbuf");
+  readsb(dev, &sb);
+  swap.start = sb.swapstart;
+  swap.nslot = sb.nswap / (PGSIZE / BSIZE);
+  if(swap.nslot > NSWAPSLOT)
+    swap.nslot = NSWAPSLOT;
+  cprintf("swap: %d slots at block %d\n", swap.nslot, swap.start);
+}
+
+// Read or write one page of the swap area.
+// Goes straight to the disk: swap blocks never enter the buffer cache.
+static void
+swaprw(int slot, char *page, int write)
+{
+  struct buf *b = &swap.buf;
+  int i;
+
+  acquiresleep(&b->lock);
+  for(i = 0; i < PGSIZE / BSIZE; i++){
+    b->dev = ROOTDEV;
+    b->blockno = swap.start + slot*(PGSIZE / BSIZE) + i;
+    if(write){
+      memmove(b->data, page + i*BSIZE, BSIZE);
+      b->flags = B_DIRTY;
+    } else {
+      b->flags = 0;
+    }
+    iderw(b);
+    if(!write)
+      memmove(page + i*BSIZE, b->data, BSIZE);
+  }
+  releasesleep(&b->lock);
+}
+
+// Drop a reference to a slot. Caller holds swap.lock.
+static void
+slotput(struct swapslot *s)
+{
+  if(--s->ref == 0 && s->zlen){
+    zdrop(s->zh, s->zlen);
+    s->zlen = 0;
+  }
+}
+
+// Reserve a free slot for reclaim(). Returns the slot,
+// or -1 if the swap area is full.
+int
+swapalloc(void)
+{
+  int i;
+
+  acquire(&swap.lock);
+  for(i = 0; i < swap.nslot; i++){
+    if(swap.slot[i].ref == 0 && !swap.slot[i].busy){
+      swap.slot[i].ref = 1;
+      swap.slot[i].busy = 1;
+      swap.slot[i].pa = 0;
+      release(&swap.lock);
+      return i;
+    }
+  }
+  release(&swap.lock);
+  return -1;
+}
+
+// Hand the frame at pa to a reserved slot; the slot takes over the
+// reference the frame's PTE had. The caller holds ptable.lock and is
+// about to store the swap entry, so nothing else can look at the
+// slot yet; swap.lock cannot be taken here since sleep() takes
+// ptable.lock while holding it.
+void
+swapassign(int slot, uint pa)
+{
+  swap.slot[slot].pa = pa;
+}
+
+// Give back a reserved slot that reclaim() found no page for.
+void
+swapcancel(int slot)
+{
+  acquire(&swap.lock);
+  swap.slot[slot].ref = 0;
+  swap.slot[slot].busy = 0;
+  release(&swap.lock);
+}
+
+// Write out the page held by a slot and drop the slot's
+// reference to its frame. May sleep.
+void
+swapwrite(int slot)
+{
+  struct swapslot *s = &swap.slot[slot];
+  uint pa;
+  int gave = 0;
+
+  // Try the compressed pool first. This happens under swap.lock,
+  // so the owner cannot take the frame back halfway through.
+  acquire(&swap.lock);
+  pa = s->pa;
+  if(pa == 0 || s->ref == 0 ||
+     (s->zlen = zput(P2V(pa), get_ref_count(pa) == 1, &gave, &s->zh)) > 0){
+    // Taken back, freed, or compressed: nothing to write.
+    if(s->zlen > 0)
+      swap.nzout++;
+    s->busy = 0;
+    s->pa = 0;
+    wakeup(s);
+    release(&swap.lock);
+    if(pa && !gave)
+      kfree(P2V(pa));
+    return;
+  }
+  release(&swap.lock);
+
+  swaprw(slot, P2V(pa), 1);
+
+  acquire(&swap.lock);
+  s->busy = 0;
+  pa = s->pa;  // 0 if swapin() took the frame back
+  s->pa = 0;
+  swap.nswapout++;
+  wakeup(s);
+  release(&swap.lock);
+
+  if(pa)
+    kfree(P2V(pa));
+}
+
+// Bring the swapped-out page at va back into memory.
+// Returns 1 if it was read from disk, 0 if it came back
+// without I/O, -1 if va is not swapped out or there is no
+// memory to put it in. May sleep.
+int
+swapin(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  struct swapslot *s;
+  uint flags;
+  uint64 t0;
+  char *mem;
+  int slot, disk;
+
+  t0 = rdtsc();
+  if((pte = get_pte(pgdir, (void*)PGROUNDDOWN(va))) == 0)
+    return -1;
+
+  acquire(&swap.lock);
+  for(;;){
+    if((*pte & PTE_SWAP) == 0){
+      release(&swap.lock);
+      return (*pte & PTE_P) ? 0 : -1;
+    }
+    slot = SWAPSLOT(*pte);
+    s = &swap.slot[slot];
+    flags = PTE_FLAGS(*pte) & (PTE_W|PTE_U|PTE_COW);
+    if(!s->busy)
+      break;
+    if(s->ref == 1){
+      // Nobody else shares the slot: reuse the frame still in it.
+      *pte = s->pa | flags | PTE_P | PTE_A;
+      s->pa = 0;
+      s->ref = 0;
+      release(&swap.lock);
+      return 0;
+    }
+    sleep(s, &swap.lock);
+  }
+  release(&swap.lock);
+
+  if((mem = kalloc()) == 0)
+    return -1;
+
+  // Our swap entry keeps the slot's contents alive meanwhile.
+  if((disk = s->zlen == 0) != 0)
+    swaprw(slot, mem, 0);
+
+  acquire(&swap.lock);
+  if(s->zlen){
+    zget(s->zh, s->zlen, mem);
+    swap.nzin++;
+    swap.zincycles += rdtsc() - t0;
+  } else {
+    swap.nswapin++;
+    swap.incycles += rdtsc() - t0;
+  }
+  *pte = V2P(mem) | flags | PTE_P | PTE_A;
+  slotput(s);
+  release(&swap.lock);
+  return disk;
+}
+
+// A swap entry is going away (unmap, exit, exec).
+void
+swapfree(pte_t pte)
+{
+  acquire(&swap.lock);
+  slotput(&swap.slot[SWAPSLOT(pte)]);
+  release(&swap.lock);
+}
+
+// A swap entry is being copied into a child by fork().
+void
+swapdup(pte_t pte)
+{
+  acquire(&swap.lock);
+  swap.slot[SWAPSLOT(pte)].ref++;
+  release(&swap.lock);
+}
+
+// total / n, without 64-bit division, which the kernel has no
+// library routine for. Scale both down until total fits in 32 bits.
+uint
+average(uint64 total, uint n)
+{
+  while(total >> 32){
+    total >>= 1;
+    n >>= 1;
+  }
+  return n ? (uint)total / n : 0;
+}
+
+int
+getswapstat(struct swapstat *st)
+{
+  int i;
+
+  acquire(&swap.lock);
+  st->nslots = swap.nslot;
+  st->used = 0;
+  for(i = 0; i < swap.nslot; i++)
+    if(swap.slot[i].ref > 0 || swap.slot[i].busy)
+      st->used++;
+  st->swapins = swap.nswapin;
+  st->swapouts = swap.nswapout;
+  st->inlat = average(swap.incycles, swap.nswapin);
+  st->zins = swap.nzin;
+  st->zouts = swap.nzout;
+  st->zinlat = average(swap.zincycles, swap.nzin);
+  release(&swap.lock);
+  zstat(st);
+  st->freepages = kfreecount();
+  return SUCCESS;
+}
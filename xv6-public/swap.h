@@ -0,0 +1,22 @@
+#ifndef SWAP_H
+#define SWAP_H
+// for `getswapstat`
+struct swapstat {
+    uint nslots;   // Page-sized slots in the swap area
+    uint used;     // Slots holding a swapped-out page
+    uint swapins;  // Pages read back in on a page fault
+    uint swapouts; // Pages written out by the reclaimer
+    uint inlat;    // Average cycles to swap in from disk
+
+    // Compressed pool (see zswap.c)
+    uint zstored;  // Pages held compressed in memory
+    uint zbytes;   // Their total compressed size
+    uint zpages;   // Pages of memory holding them
+    uint zmaxpages;// Cap on zpages
+    uint zins;     // Pages decompressed on a page fault
+    uint zouts;    // Pages compressed by the reclaimer
+    uint zinlat;   // Average cycles to swap in from the pool
+
+    uint freepages;// Pages of memory free right now
+};
+#endif
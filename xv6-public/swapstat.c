@@ -0,0 +1,28 @@
+// Print swap and compressed-pool statistics.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "swap.h"
+
+int
+main(void)
+{
+  struct swapstat st;
+  uint r;
+
+  if(getswapstat(&st) < 0){
+    printf(2, "swapstat: failed\n");
+    exit();
+  }
+  printf(1, "memory: %d pages free\n", st.freepages);
+  printf(1, "disk:  %d/%d slots used, %d in, %d out, %d cycles/fault\n",
+         st.used, st.nslots, st.swapins, st.swapouts, st.inlat);
+  printf(1, "zswap: %d pages in %d/%d pool pages, %d in, %d out, %d cycles/fault\n",
+         st.zstored, st.zpages, st.zmaxpages, st.zins, st.zouts, st.zinlat);
+  if(st.zbytes >= 10){
+    r = st.zstored * 4096 / (st.zbytes / 10);
+    printf(1, "zswap: %d bytes compressed, ratio %d.%d\n", st.zbytes, r / 10, r % 10);
+  }
+  exit();
+}
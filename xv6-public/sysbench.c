@@ -0,0 +1,39 @@
+// System call rate: cycles per getpid() and per uptime(),
+// the cheapest calls there are, so the cost is almost all
+// trap entry and exit and finding the current process.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NCALL 100000
+
+static uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
+void
+bench(char *name, int (*call)(void))
+{
+  uint64 t0, total;
+  int i;
+
+  t0 = rdtsc();
+  for(i = 0; i < NCALL; i++)
+    call();
+  total = rdtsc() - t0;
+  // No 64-bit division in user space.
+  printf(1, "%s: %d calls, %d cycles/call\n", name, NCALL, (uint)(total >> 4) / (NCALL >> 4));
+}
+
+int
+main(void)
+{
+  bench("getpid", getpid);
+  bench("uptime", uptime);
+  exit();
+}
@@ -17,12 +17,7 @@
 int
 fetchint(uint addr, int *ip)
 {
-  struct proc *curproc = myproc();
-
-  if(addr >= curproc->sz || addr+4 > curproc->sz)
-    return -1;
-  *ip = *(int*)(addr);
-  return 0;
+  return copy_from_user(ip, addr, sizeof(*ip));
 }
 
 // Fetch the nul-terminated string at addr from the current process.
@@ -31,18 +26,10 @@ fetchint(uint addr, int *ip)
 int
 fetchstr(uint addr, char **pp)
 {
-  char *s, *ep;
-  struct proc *curproc = myproc();
-
-  if(addr >= curproc->sz)
+  if(addr >= KERNBASE)
     return -1;
   *pp = (char*)addr;
-  ep = (char*)curproc->sz;
-  for(s = *pp; s < ep; s++){
-    if(*s == 0)
-      return s - *pp;
-  }
-  return -1;
+  return userstrlen(*pp, KERNBASE - addr);
 }
 
 // Fetch the nth 32-bit system call argument.
@@ -53,17 +40,31 @@ argint(int n, int *ip)
 }
 
 // Fetch the nth word-sized system call argument as a pointer
-// to a block of memory of size bytes.  Check that the pointer
-// lies within the process address space.
+// to a block of memory of size bytes, which the kernel may write.
+// Check that the pointer lies within the process address space,
+// below sz or in wmap regions, and fault in any pages not yet there.
 int
 argptr(int n, char **pp, int size)
 {
   int i;
-  struct proc *curproc = myproc();
- 
+
+  if(argint(n, &i) < 0)
+    return -1;
+  if(size < 0 || prefault(myproc(), i, size, 1) < 0)
+    return -1;
+  *pp = (char*)i;
+  return 0;
+}
+
+// Like argptr, for a block the kernel only reads.
+int
+argcptr(int n, char **pp, int size)
+{
+  int i;
+
   if(argint(n, &i) < 0)
     return -1;
-  if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
+  if(size < 0 || prefault(myproc(), i, size, 0) < 0)
     return -1;
   *pp = (char*)i;
   return 0;
@@ -107,6 +108,24 @@ extern int sys_wmap(void);
 extern int sys_wunmap(void);
 extern int sys_getwmapinfo(void);
 extern int sys_va2pa(void);
+extern int sys_getswapstat(void);
+extern int sys_getksmstat(void);
+extern int sys_wfault(void);
+extern int sys_wfill(void);
+extern int sys_wprotect(void);
+extern int sys_getmemstat(void);
+extern int sys_pagemap(void);
+extern int sys_getfaulthist(void);
+extern int sys_spawn(void);
+extern int sys_setpriority(void);
+extern int sys_getschedstats(void);
+extern int sys_setaffinity(void);
+extern int sys_getaffinity(void);
+extern int sys_clock_gettime(void);
+extern int sys_nanosleep(void);
+extern int sys_getcpustat(void);
+extern int sys_lockstat(void);
+extern int sys_wfhandler(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -134,6 +153,24 @@ static int (*syscalls[])(void) = {
 [SYS_wunmap]    sys_wunmap,
 [SYS_getwmapinfo]    sys_getwmapinfo,
 [SYS_va2pa] sys_va2pa,
+[SYS_getswapstat]    sys_getswapstat,
+[SYS_getksmstat]     sys_getksmstat,
+[SYS_wfault]         sys_wfault,
+[SYS_wfill]          sys_wfill,
+[SYS_wprotect]       sys_wprotect,
+[SYS_getmemstat]     sys_getmemstat,
+[SYS_pagemap]        sys_pagemap,
+[SYS_getfaulthist]   sys_getfaulthist,
+[SYS_spawn]          sys_spawn,
+[SYS_setpriority]    sys_setpriority,
+[SYS_getschedstats]  sys_getschedstats,
+[SYS_setaffinity]    sys_setaffinity,
+[SYS_getaffinity]    sys_getaffinity,
+[SYS_clock_gettime]  sys_clock_gettime,
+[SYS_nanosleep]      sys_nanosleep,
+[SYS_getcpustat]     sys_getcpustat,
+[SYS_lockstat]       sys_lockstat,
+[SYS_wfhandler]      sys_wfhandler,
 };
 
 void
@@ -24,3 +24,21 @@
 #define SYS_wmap  23
 #define SYS_wunmap  24
 #define SYS_getwmapinfo  25
+#define SYS_getswapstat  26
+#define SYS_getksmstat   27
+#define SYS_wfault       28
+#define SYS_wfill        29
+#define SYS_wprotect     30
+#define SYS_getmemstat   31
+#define SYS_pagemap      32
+#define SYS_getfaulthist 33
+#define SYS_spawn        34
+#define SYS_setpriority  35
+#define SYS_getschedstats 36
+#define SYS_setaffinity  37
+#define SYS_getaffinity  38
+#define SYS_clock_gettime 39
+#define SYS_nanosleep    40
+#define SYS_getcpustat   41
+#define SYS_lockstat     42
+#define SYS_wfhandler    43
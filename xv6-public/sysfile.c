@@ -8,6 +8,7 @@
 #include "defs.h"
 #include "param.h"
 #include "stat.h"
+#include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
 #include "fs.h"
@@ -15,6 +16,7 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "spawn.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -66,28 +68,67 @@ sys_dup(void)
   return fd;
 }
 
+// Move n bytes between file f and user address p. Inode files
+// copy straight between the buffer cache and user memory; pipes
+// and the console copy with a spinlock held, where a user page
+// can't be faulted in, so they go through a buffer on the stack.
+static int
+filerw(struct file *f, uint p, int n, int write)
+{
+  char buf[512];
+  int tot, m, r;
+
+  if(n < 0 || p + n < p || p + n > KERNBASE)
+    return -1;
+  if(f->type == FD_INODE && f->ip->type != T_DEV)
+    return write ? filewriteuser(f, p, n) : filereaduser(f, p, n);
+
+  for(tot = 0; tot < n; tot += r){
+    m = n - tot < sizeof(buf) ? n - tot : sizeof(buf);
+    if(write){
+      r = copy_from_user(buf, p + tot, m);
+      if(r == 0)
+        r = filewrite(f, buf, m);
+    } else {
+      r = fileread(f, buf, m);
+      if(r > 0 && copy_to_user(p + tot, buf, r) < 0)
+        r = -1;
+    }
+    if(r < 0){
+      if(tot == 0)
+        tot = -1;
+      break;
+    }
+    // A short read is all a pipe or the console had;
+    // don't block waiting for more.
+    if(!write){
+      tot += r;
+      break;
+    }
+  }
+  return tot;
+}
+
 int
 sys_read(void)
 {
   struct file *f;
-  int n;
-  char *p;
+  int n, p;
 
-  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argint(1, &p) < 0)
     return -1;
-  return fileread(f, p, n);
+  return filerw(f, p, n, 0);
 }
 
 int
 sys_write(void)
 {
   struct file *f;
-  int n;
-  char *p;
+  int n, p;
 
-  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argint(1, &p) < 0)
     return -1;
-  return filewrite(f, p, n);
+  return filerw(f, p, n, 1);
 }
 
 int
@@ -393,19 +434,16 @@ sys_chdir(void)
   return 0;
 }
 
-int
-sys_exec(void)
+// Fetch the null-terminated user array of strings at uargv.
+static int
+fetchargv(uint uargv, char **argv)
 {
-  char *path, *argv[MAXARG];
   int i;
-  uint uargv, uarg;
+  uint uarg;
 
-  if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0){
-    return -1;
-  }
-  memset(argv, 0, sizeof(argv));
+  memset(argv, 0, MAXARG*sizeof(argv[0]));
   for(i=0;; i++){
-    if(i >= NELEM(argv))
+    if(i >= MAXARG)
       return -1;
     if(fetchint(uargv+4*i, (int*)&uarg) < 0)
       return -1;
@@ -416,9 +454,50 @@ sys_exec(void)
     if(fetchstr(uarg, &argv[i]) < 0)
       return -1;
   }
+  return 0;
+}
+
+int
+sys_exec(void)
+{
+  char *path, *argv[MAXARG];
+  uint uargv;
+
+  if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0){
+    return -1;
+  }
+  if(fetchargv(uargv, argv) < 0)
+    return -1;
   return exec(path, argv);
 }
 
+int
+sys_spawn(void)
+{
+  char *path, *argv[MAXARG];
+  struct spawnfa fa[MAXSPAWNFA];
+  uint uargv, ufa;
+  int nfa;
+
+  if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0 ||
+     argint(2, (int*)&ufa) < 0)
+    return -1;
+  if(fetchargv(uargv, argv) < 0)
+    return -1;
+  nfa = 0;
+  if(ufa){
+    for(;; nfa++){
+      if(nfa >= MAXSPAWNFA)
+        return -1;
+      if(copy_from_user(&fa[nfa], ufa + nfa*sizeof(fa[0]), sizeof(fa[0])) < 0)
+        return -1;
+      if(fa[nfa].fd < 0)
+        break;
+    }
+  }
+  return spawn(path, argv, fa, nfa);
+}
+
 int
 sys_pipe(void)
 {
@@ -7,6 +7,11 @@
 #include "mmu.h"
 #include "proc.h"
 #include "wmap.h"
+#include "swap.h"
+#include "ksm.h"
+#include "memstat.h"
+#include "clock.h"
+#include "lockstat.h"
 
 int
 sys_fork(void)
@@ -61,21 +66,12 @@ int
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
-  return 0;
+  if(n <= 0)
+    return 0;
+  return ticksleep(n);
 }
 
 // return how many clock tick interrupts have occurred
@@ -132,3 +128,215 @@ sys_va2pa(void)
 
   return va2pa(va);
 }
+
+int
+sys_wfault(void)
+{
+  struct wfaultinfo *info;
+
+  if(argptr(0, (void*)&info, sizeof(*info)) < 0)
+    return FAILED;
+  return wfault(info);
+}
+
+int
+sys_wfill(void)
+{
+  int pid;
+  uint addr;
+  char *src;
+
+  if(argint(0, &pid) < 0 || argint(1, (int*)&addr) < 0 ||
+     argcptr(2, &src, PGSIZE) < 0)
+    return FAILED;
+  return wfill(pid, addr, src);
+}
+
+int
+sys_wfhandler(void)
+{
+  uint addr;
+  int pid;
+
+  if(argint(0, (int*)&addr) < 0 || argint(1, &pid) < 0)
+    return FAILED;
+  return wfhandler(addr, pid);
+}
+
+int
+sys_wprotect(void)
+{
+  uint addr;
+  int length, prot;
+
+  if(argint(0, (int*)&addr) < 0 || argint(1, &length) < 0 || argint(2, &prot) < 0)
+    return FAILED;
+  return wprotect(addr, length, prot);
+}
+
+int
+sys_getswapstat(void)
+{
+  struct swapstat *st;
+
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+    return FAILED;
+  return getswapstat(st);
+}
+
+int
+sys_getksmstat(void)
+{
+  struct ksmstat *st;
+
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+    return FAILED;
+  return getksmstat(st);
+}
+
+int
+sys_getmemstat(void)
+{
+  struct memstat st;
+  int pid, addr;
+
+  if(argint(0, &pid) < 0 || argint(1, &addr) < 0)
+    return FAILED;
+  if(getmemstat(pid, &st) < 0 || copy_to_user(addr, &st, sizeof(st)) < 0)
+    return FAILED;
+  return SUCCESS;
+}
+
+int
+sys_pagemap(void)
+{
+  int va, n, ents;
+
+  if(argint(0, &va) < 0 || argint(1, &n) < 0 || argint(2, &ents) < 0)
+    return FAILED;
+  return pagemap(va, n, ents);
+}
+
+int
+sys_getfaulthist(void)
+{
+  struct faulthist h;
+  int cpu, addr;
+
+  if(argint(0, &cpu) < 0 || argint(1, &addr) < 0)
+    return FAILED;
+  if(getfaulthist(cpu, &h) < 0 || copy_to_user(addr, &h, sizeof(h)) < 0)
+    return FAILED;
+  return SUCCESS;
+}
+
+int
+sys_setpriority(void)
+{
+  int pid, level;
+
+  if(argint(0, &pid) < 0 || argint(1, &level) < 0)
+    return FAILED;
+  return setpriority(pid, level);
+}
+
+int
+sys_getschedstats(void)
+{
+  struct schedstat st;
+  int pid, addr;
+
+  if(argint(0, &pid) < 0 || argint(1, &addr) < 0)
+    return FAILED;
+  if(getschedstats(pid, &st) < 0 || copy_to_user(addr, &st, sizeof(st)) < 0)
+    return FAILED;
+  return SUCCESS;
+}
+
+int
+sys_setaffinity(void)
+{
+  int pid, mask;
+
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return FAILED;
+  return setaffinity(pid, mask);
+}
+
+int
+sys_getaffinity(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return FAILED;
+  return getaffinity(pid);
+}
+
+int
+sys_getcpustat(void)
+{
+  struct cpustat st;
+  int cpu, addr;
+
+  if(argint(0, &cpu) < 0 || argint(1, &addr) < 0)
+    return FAILED;
+  if(getcpustat(cpu, &st) < 0 || copy_to_user(addr, &st, sizeof(st)) < 0)
+    return FAILED;
+  return SUCCESS;
+}
+
+int
+sys_clock_gettime(void)
+{
+  struct timespec ts;
+  int clock, addr;
+  uint64 ns;
+
+  if(argint(0, &clock) < 0 || argint(1, &addr) < 0)
+    return FAILED;
+  if(clock != CLOCK_MONOTONIC)
+    return FAILED;
+  ns = nsuptime();
+  ts.tv_sec = udiv64(ns, 1000000000, &ts.tv_nsec);
+  if(copy_to_user(addr, &ts, sizeof(ts)) < 0)
+    return FAILED;
+  return SUCCESS;
+}
+
+int
+sys_nanosleep(void)
+{
+  struct timespec ts;
+  int addr;
+
+  if(argint(0, &addr) < 0 || copy_from_user(&ts, addr, sizeof(ts)) < 0)
+    return FAILED;
+  if(ts.tv_nsec >= 1000000000)
+    return FAILED;
+  return nssleep((uint64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+// Turn lock statistics on or off, or copy out those
+// for up to n lock names. Returns how many were copied.
+int
+sys_lockstat(void)
+{
+  struct lockstat st;
+  int op, addr, n, i;
+
+  if(argint(0, &op) < 0 || argint(1, &addr) < 0 || argint(2, &n) < 0)
+    return FAILED;
+  switch(op){
+  case LS_ON:
+  case LS_OFF:
+    lockstatctl(op == LS_ON);
+    return SUCCESS;
+  case LS_READ:
+    for(i = 0; i < n && getlockstat(i, &st) == 0; i++)
+      if(copy_to_user(addr + i*sizeof(st), &st, sizeof(st)) < 0)
+        return FAILED;
+    return i;
+  }
+  return FAILED;
+}
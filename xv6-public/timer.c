@@ -0,0 +1,299 @@
+// Kernel timers.
+//
+// settimer() arranges for fn(arg) to be called from the clock
+// interrupt on CPU 0 once ticks reaches a deadline. Timers live on a
+// hierarchical wheel: NLEVEL levels of WSIZE slots each, where a slot
+// of level l covers WSIZE^l ticks. A timer goes into the lowest level
+// whose range covers its deadline, so adding and removing one is
+// O(1). Each tick expires one slot of level 0; when the level-0 index
+// wraps, the current slot of level 1 is emptied and its timers are
+// put back into level 0, and so on up. Deadlines beyond the top
+// level's range are clamped to it.
+//
+// High-resolution timers (sethrtimer) have a TSC deadline instead,
+// and sit on a sorted queue for the CPU that armed them. That CPU's
+// LAPIC timer is programmed for the earlier of its next clock tick
+// and the head of the queue (see lapicarm), so they fire when due
+// rather than at the next tick.
+//
+// Handlers run with timers.lock held and interrupts off, so they must
+// be short and must not call settimer() or deltimer(); a periodic job
+// should have its handler wake a thread that re-arms the timer.
+// The lock order is timers.lock, then ptable.lock.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "timer.h"
+
+#define WBITS    6
+#define WSIZE    (1 << WBITS)
+#define WMASK    (WSIZE - 1)
+#define NLEVEL   4
+#define MAXDELAY ((1U << (WBITS*NLEVEL)) - 1)
+
+struct {
+  struct spinlock lock;
+  uint now;                           // Next tick to process
+  struct timer *wheel[NLEVEL][WSIZE];
+  struct hrtimer *hrq[NCPU];          // High-resolution, per CPU
+} timers;
+
+void
+timerinit(void)
+{
+  initlock(&timers.lock, "timers");
+}
+
+// Put t into the slot its deadline falls in. Caller holds timers.lock.
+static void
+wheeladd(struct timer *t)
+{
+  struct timer **slot;
+  uint delta;
+  int l;
+
+  delta = t->expires - timers.now;
+  if((int)delta < 0){
+    // Already due: fire on the next tick processed.
+    slot = &timers.wheel[0][timers.now & WMASK];
+  } else {
+    if(delta > MAXDELAY){
+      t->expires = timers.now + MAXDELAY;
+      delta = MAXDELAY;
+    }
+    for(l = 0; l < NLEVEL-1 && delta >> (WBITS*(l+1)); l++)
+      ;
+    slot = &timers.wheel[l][(t->expires >> (WBITS*l)) & WMASK];
+  }
+  t->next = *slot;
+  if(t->next)
+    t->next->pprev = &t->next;
+  t->pprev = slot;
+  *slot = t;
+}
+
+static void
+wheeldel(struct timer *t)
+{
+  *t->pprev = t->next;
+  if(t->next)
+    t->next->pprev = t->pprev;
+}
+
+// Empty the current slot of level l back into the lower levels.
+// Returns the slot's index.
+static int
+cascade(int l)
+{
+  struct timer *t, *next;
+  int i;
+
+  i = (timers.now >> (WBITS*l)) & WMASK;
+  t = timers.wheel[l][i];
+  timers.wheel[l][i] = 0;
+  for(; t; t = next){
+    next = t->next;
+    wheeladd(t);
+  }
+  return i;
+}
+
+// Arm t to call fn(arg) when ticks reaches expires.
+// t must not be pending.
+void
+settimer(struct timer *t, uint expires, void (*fn)(void*), void *arg)
+{
+  acquire(&timers.lock);
+  if(t->pending)
+    panic("settimer");
+  t->expires = expires;
+  t->fn = fn;
+  t->arg = arg;
+  t->pending = 1;
+  wheeladd(t);
+  release(&timers.lock);
+}
+
+// Disarm t. Returns 1 if it was pending, 0 if it had already fired.
+int
+deltimer(struct timer *t)
+{
+  int pending;
+
+  acquire(&timers.lock);
+  if((pending = t->pending) != 0){
+    wheeldel(t);
+    t->pending = 0;
+  }
+  release(&timers.lock);
+  return pending;
+}
+
+// Called by the clock interrupt on CPU 0 after ticks has advanced
+// to now. Runs every timer that has come due.
+void
+runtimers(uint now)
+{
+  struct timer *t;
+  int i, l;
+
+  acquire(&timers.lock);
+  while((int)(now - timers.now) >= 0){
+    i = timers.now & WMASK;
+    if(i == 0)
+      for(l = 1; l < NLEVEL && cascade(l) == 0; l++)
+        ;
+    while((t = timers.wheel[0][i]) != 0){
+      wheeldel(t);
+      t->pending = 0;
+      t->fn(t->arg);
+    }
+    timers.now++;
+  }
+  release(&timers.lock);
+}
+
+// Arm t to call fn(arg) on this CPU when the TSC reaches expires.
+// t must not be pending.
+void
+sethrtimer(struct hrtimer *t, uint64 expires, void (*fn)(void*), void *arg)
+{
+  struct hrtimer **q;
+
+  acquire(&timers.lock);
+  if(t->pending)
+    panic("sethrtimer");
+  t->expires = expires;
+  t->fn = fn;
+  t->arg = arg;
+  t->pending = 1;
+  t->cpu = cpuid();
+  for(q = &timers.hrq[t->cpu]; *q && (*q)->expires <= expires; q = &(*q)->next)
+    ;
+  t->next = *q;
+  *q = t;
+  if(timers.hrq[t->cpu] == t)
+    lapicarm(expires);
+  release(&timers.lock);
+}
+
+static void
+hrdel(struct hrtimer *t)
+{
+  struct hrtimer **q;
+
+  for(q = &timers.hrq[t->cpu]; *q != t; q = &(*q)->next)
+    ;
+  *q = t->next;
+  t->pending = 0;
+}
+
+// Disarm t. Returns 1 if it was pending, 0 if it had already fired.
+// The LAPIC may still interrupt at its deadline, to no effect.
+int
+delhrtimer(struct hrtimer *t)
+{
+  int pending;
+
+  acquire(&timers.lock);
+  if((pending = t->pending) != 0)
+    hrdel(t);
+  release(&timers.lock);
+  return pending;
+}
+
+// Program the LAPIC for this CPU's next high-resolution
+// timer or clock tick.
+void
+hrarm(void)
+{
+  struct hrtimer *t;
+
+  acquire(&timers.lock);
+  t = timers.hrq[cpuid()];
+  lapicarm(t ? t->expires : 0);
+  release(&timers.lock);
+}
+
+// Called by every timer interrupt. Runs this CPU's
+// high-resolution timers that have come due, and
+// programs the LAPIC for the next one.
+void
+runhrtimers(void)
+{
+  struct hrtimer *t, **q;
+
+  acquire(&timers.lock);
+  q = &timers.hrq[cpuid()];
+  while((t = *q) != 0 && t->expires <= rdtsc()){
+    *q = t->next;
+    t->pending = 0;
+    t->fn(t->arg);
+  }
+  lapicarm(*q ? (*q)->expires : 0);
+  release(&timers.lock);
+}
+
+static void
+timerwake(void *chan)
+{
+  wakeup(chan);
+}
+
+// Sleep for n ticks. Only the caller is woken when they are up,
+// rather than every sleeper on every tick.
+// Returns -1 if the process is killed first.
+int
+ticksleep(uint n)
+{
+  struct timer t;
+  int r = 0;
+
+  if(n == 0)
+    return 0;
+  t.pending = 0;
+  settimer(&t, ticks + n, timerwake, &t);
+  acquire(&timers.lock);
+  while(t.pending){
+    if(myproc()->killed){
+      wheeldel(&t);
+      t.pending = 0;
+      r = -1;
+      break;
+    }
+    sleep(&t, &timers.lock);
+  }
+  release(&timers.lock);
+  return r;
+}
+
+// Sleep for ns nanoseconds, on a high-resolution timer.
+// Returns -1 if the process is killed first.
+int
+nssleep(uint64 ns)
+{
+  struct hrtimer t;
+  int r = 0;
+
+  if(ns == 0)
+    return 0;
+  t.pending = 0;
+  sethrtimer(&t, rdtsc() + nstocycles(ns), timerwake, &t);
+  acquire(&timers.lock);
+  while(t.pending){
+    if(myproc()->killed){
+      hrdel(&t);
+      r = -1;
+      break;
+    }
+    sleep(&t, &timers.lock);
+  }
+  release(&timers.lock);
+  return r;
+}
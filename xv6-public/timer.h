@@ -0,0 +1,20 @@
+// A kernel timer; see timer.c.
+struct timer {
+  uint expires;            // Value of ticks at which fn runs
+  void (*fn)(void*);       // Called from the clock interrupt
+  void *arg;
+  int pending;             // On the wheel
+  struct timer *next;      // In its wheel slot
+  struct timer **pprev;    // What points at us
+};
+
+// A high-resolution timer: fires on the CPU that armed it,
+// from a LAPIC interrupt programmed for its deadline.
+struct hrtimer {
+  uint64 expires;          // TSC value at which fn runs
+  void (*fn)(void*);       // Called from the timer interrupt
+  void *arg;
+  int pending;             // On its CPU's queue
+  int cpu;                 // Which one
+  struct hrtimer *next;    // In the queue, by expires
+};
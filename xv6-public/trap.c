@@ -17,6 +17,14 @@
 //
 struct gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
+
+// Exception table built by usercopy.S; see kernel.ld.
+struct exentry {
+  uint insn;   // instruction that may fault on a user address
+  uint fixup;  // where to resume if it does
+};
+extern struct exentry __EXTABLE_BEGIN__[], __EXTABLE_END__[];
+
 struct spinlock tickslock;
 uint ticks;
 
@@ -38,10 +46,233 @@ idtinit(void)
   lidt(idt, sizeof(idt));
 }
 
+// Count a fault of the given kind that pagefault() began at
+// cycle t0 in this CPU's histogram. The process may have moved
+// to another CPU while it slept; the fault counts where it ends.
+static void
+faulttime(int kind, uint64 t0)
+{
+  uint64 d;
+  int b;
+
+  d = rdtsc() - t0;
+  for(b = 0; b < NFAULTBIN - 1 && (d >> (b + 1)) != 0; b++)
+    ;
+  pushcli();
+  mycpu()->fhist.count[kind][b]++;
+  popcli();
+}
+
+// Sum of the fault histograms of every CPU, or of one if cpu >= 0.
+int
+getfaulthist(int cpu, struct faulthist *h)
+{
+  int c, k, b;
+
+  if(cpu >= ncpu)
+    return -1;
+  memset(h, 0, sizeof(*h));
+  for(c = 0; c < ncpu; c++){
+    if(cpu >= 0 && c != cpu)
+      continue;
+    for(k = 0; k < NFAULTKIND; k++)
+      for(b = 0; b < NFAULTBIN; b++)
+        h->count[k][b] += cpus[c].fhist.count[k][b];
+  }
+  return 0;
+}
+
+// Make the user page at va in p accessible for a read, or a write
+// if write is set: swap it in, read it from its file, break COW, and
+// so on. Called by trap() and by kernel code that is about to touch
+// user memory (see prefault). Returns 0 on success, -1 if va is not
+// mapped or its protection forbids the access, and -2 if the page
+// could not be brought in (out of memory, I/O error, or p was
+// killed while waiting for a userfault handler). May sleep.
+int
+pagefault(struct proc *p, uint va, int write)
+{
+  struct mmap_region *region;
+  pte_t *pte, old;
+  uint pa;
+  char *mem;
+  uint64 t0;
+  int r;
+
+  t0 = rdtsc();
+  va = PGROUNDDOWN(va);
+  if (va >= KERNBASE)
+    return -1;
+  // Page table still shared since fork: take a copy before
+  // changing anything in it.
+  if (ptshared(p->pgdir, va) && unsharept(p->pgdir, va) < 0)
+    return -2;
+  pte = get_pte(p->pgdir, (void *)va);
+  region = findregion(p, va);
+
+  // Protection fault: the map's wprotect() setting forbids this
+  // access. Told apart from a COW fault, which is a write to a
+  // PTE_COW page the map does allow writing.
+  if (region != 0 && !regionallows(region, write))
+    return -1;
+
+  // Swapped out: read it back in.
+  if (pte != 0 && (*pte & PTE_SWAP)) {
+    if ((r = swapin(p->pgdir, va)) < 0)
+      return -2;
+    if (r > 0)
+      p->mstat.majflt++;
+    else
+      p->mstat.minflt++;
+    pageresident(p, va, 1);
+    faulttime(FK_SWAP, t0);
+    return 0;
+  }
+
+  if (pte != 0 && (*pte & PTE_P)) {
+    if ((*pte & PTE_U) && (!write || (*pte & PTE_W)))
+      return 0;  // nothing to do
+    if (!write || !(*pte & PTE_COW) || (*pte & PTE_W))
+      return -1;
+
+    // COW: copy the page unless nobody else maps it.
+    pa = PTE_ADDR(*pte);
+    if (get_ref_count(pa) == 1) {
+      *pte |= PTE_W;
+      *pte &= ~PTE_COW;
+    } else {
+      // Clear the PTE so reclaim() cannot pick it meanwhile.
+      old = *pte;
+      *pte = 0;
+      if ((mem = kalloc()) == 0) {
+        *pte = old;
+        return -2;
+      }
+      memmove(mem, (char *)P2V(pa), PGSIZE);
+      perform_mapping(p->pgdir, (char *)va, PGSIZE, V2P(mem), PTE_W | PTE_U);
+      kfree(P2V(pa));
+    }
+    lcr3(V2P(p->pgdir));
+    p->mstat.cowflt++;
+    p->mstat.minflt++;
+    faulttime(FK_COW, t0);
+    return 0;
+  }
+
+  // Program text dropped by reclaim(): read it back.
+  if (va < p->sz) {
+    if (textfault(p, va) < 0)
+      return -1;
+    p->mstat.majflt++;
+    p->mstat.fileread++;
+    pageresident(p, va, 1);
+    faulttime(FK_FILE, t0);
+    return 0;
+  }
+
+  if (region == 0)
+    return -1;
+
+  // Wait for the region's handler to wfill() the page;
+  // ufmap() accounts for it.
+  if (region->flags & MAP_USERFAULT) {
+    if (userfault(p, va) < 0 || p->killed)
+      return -2;
+    p->mstat.majflt++;
+    faulttime(FK_UFAULT, t0);
+    return 0;
+  }
+
+  if ((mem = kalloc()) == 0)
+    return -2;
+  memset(mem, 0, PGSIZE);
+
+  if (!(region->flags & MAP_ANONYMOUS) && region->fd != 0) {
+    if (region->file == 0 || region->file->type != FD_INODE) {
+      kfree(mem);
+      return -2;
+    }
+
+    int offset = va - region->base;
+    ilock(region->file->ip);
+    int bytes_read = readi(region->file->ip, mem, offset, PGSIZE);
+    iunlock(region->file->ip);
+
+    if (bytes_read < 0) {
+      kfree(mem);
+      return -2;
+    }
+  }
+
+  if (perform_mapping(p->pgdir, (void *)va, PGSIZE, V2P(mem), regionperm(region)) != 0) {
+    kfree(mem);
+    return -2;
+  }
+  if (region->file) {
+    p->mstat.majflt++;
+    p->mstat.fileread++;
+    faulttime(FK_FILE, t0);
+  } else {
+    p->mstat.minflt++;
+    p->mstat.zerofill++;
+    faulttime(FK_ZERO, t0);
+  }
+  pageresident(p, va, 1);
+  return 0;
+}
+
+// Check that [va, va+n) is memory of p that allows a read, or a write
+// if write is set, either below p->sz or in wmap regions, and fault
+// in every page of it that is not ready for that access. Kernel code
+// must call this before touching user memory while holding a spinlock
+// (pipes, the console), since the fault handler may sleep.
+// Returns 0, or -1 if the range is not accessible.
+int
+prefault(struct proc *p, uint va, uint n, int write)
+{
+  struct mmap_region *r;
+  pte_t *pte;
+  uint a;
+
+  if (va + n < va || va + n > KERNBASE)
+    return -1;
+  for (a = PGROUNDDOWN(va); a < va + n; a += PGSIZE) {
+    r = 0;
+    if (a >= p->sz && (r = findregion(p, a)) == 0)
+      return -1;
+    pte = get_pte(p->pgdir, (void *)a);
+    if (pte != 0 && (*pte & (PTE_P | PTE_U)) == (PTE_P | PTE_U) &&
+        (!write || ((*pte & PTE_W) && !ptshared(p->pgdir, a))))
+      continue;
+    if (pagefault(p, a, write) < 0)
+      return -1;
+    pte = get_pte(p->pgdir, (void *)a);
+    if (pte == 0 || (*pte & (PTE_P | PTE_U)) != (PTE_P | PTE_U) ||
+        (write && !(*pte & PTE_W)))
+      return -1;
+  }
+  return 0;
+}
+
+// Fixup address for a kernel instruction that faulted at eip,
+// or 0 if it is not allowed to fault.
+static uint
+extable(uint eip)
+{
+  struct exentry *e;
+
+  for (e = __EXTABLE_BEGIN__; e < __EXTABLE_END__; e++)
+    if (e->insn == eip)
+      return e->fixup;
+  return 0;
+}
+
 //PAGEBREAK: 41
 void
 trap(struct trapframe *tf)
 {
+  int tick = 0;
+
   if(tf->trapno == T_SYSCALL){
     if(myproc()->killed)
       exit();
@@ -49,23 +280,36 @@ trap(struct trapframe *tf)
     syscall();
     if(myproc()->killed)
       exit();
+    if(myproc()->resched)
+      yield();
     return;
   }
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
-    if(cpuid() == 0){
+    // The LAPIC timer is one-shot: it may be here for a clock
+    // tick, a high-resolution timer, or both.
+    tick = lapictimer();
+    if(tick && cpuid() == 0){
       acquire(&tickslock);
       ticks++;
-      wakeup(&ticks);
       release(&tickslock);
+      runtimers(ticks);
+      if(ticks % MLFQBOOST == 0)
+        mlfqboost();
     }
+    runhrtimers();
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
     ideintr();
     lapiceoi();
     break;
+  case T_IRQ0 + IRQ_RESCHED:
+    // Nothing to do: the interrupt gets the CPU out of hlt in
+    // scheduler(), or the process to the resched check below.
+    lapiceoi();
+    break;
   case T_IRQ0 + IRQ_IDE+1:
     // Bochs generates spurious IDE1 interrupts.
     break;
@@ -85,102 +329,27 @@ trap(struct trapframe *tf)
     break;
   case T_PGFLT:
   {
-    uint fault_addr = rcr2();
-    fault_addr = PGROUNDDOWN(fault_addr);
-    struct proc *p = myproc();
-    int mapped = 0;
-
-    pte_t *pte = get_pte(p->pgdir, (void *)fault_addr);
-
-    // Edge case to handle if user doesn't have access to the page.
-    // if (pte && !(*pte & PTE_U)) {
-    //   // User doesn't have access to the page
-    //   cprintf("Segmentation Fault\n");
-    //   exit();
-    // }
-
-    if (pte != 0) {
-      uint pa = PTE_ADDR(*pte);
-
-      if (get_ref_count(pa) == 0) {
-        pte = 0;
-      }
+    uint fixup = (tf->cs&3) == 0 ? extable(tf->eip) : 0;
+    int r;
+    if (fixup && mycpu()->ncli > 0)
+      r = -1;  // cannot sleep to bring the page in
+    else
+      r = pagefault(myproc(), rcr2(), tf->err & FEC_WR);
+    if (r < 0 && fixup) {
+      // A user copy (usercopy.S) hit a bad address: make it fail.
+      tf->eip = fixup;
+      break;
     }
-
-    if (pte != 0) {
-      uint pa = PTE_ADDR(*pte);
-
-      // allowed to write
-      if (!(*pte & PTE_W) && (*pte & PTE_COW)) {
-        // PAGE can be written
-        uint ref_cnt = get_ref_count(pa);
-        if (ref_cnt == 1) {
-          *pte |= PTE_W;
-          *pte &= ~PTE_COW;
-        } else if (ref_cnt > 1) {
-          char *mem;
-          *pte = 0;
-
-          if ((mem = kalloc()) == 0) {
-            exit();
-          }
-
-          memmove(mem, (char *)P2V(pa), PGSIZE);
-          perform_mapping(p->pgdir, (char *)fault_addr, PGSIZE, V2P(mem),
-                          PTE_W | PTE_U);
-          kfree(P2V(pa));
-          lcr3(V2P(p->pgdir));
-        }
-      } else {
-        cprintf("Segmentation Fault\n");
-        exit();
-      }
-    } else {
-      for (int i = 0; i < p->mmap_count; i++) {
-        struct mmap_region *region = &p->mmap_regions[i];
-        if (fault_addr >= region->addr &&
-            fault_addr < (region->addr + region->length)) {
-          char *mem = kalloc();
-          if (mem == 0) {
-            kill(p->pid);
-            break;
-          }
-
-          memset(mem, 0, PGSIZE);
-
-          if (!(region->flags & MAP_ANONYMOUS) && region->fd != 0) {
-            if (region->file == 0 || region->file->type != FD_INODE) {
-              kfree(mem);
-              kill(p->pid);
-              break;
-            }
-
-            int offset = fault_addr - region->addr;
-            ilock(region->file->ip);
-            int bytes_read = readi(region->file->ip, mem, offset, PGSIZE);
-            iunlock(region->file->ip);
-
-            if (bytes_read < 0) {
-              kfree(mem);
-              kill(p->pid);
-              break;
-            }
-          }
-
-          int result = perform_mapping(p->pgdir, (void *)fault_addr, PGSIZE,
-                                       V2P(mem), PTE_W | PTE_U);
-
-          if (result != 0) {
-            exit();
-          }
-          mapped = 1;
-          break;
-        }
-      }
-      if (!mapped) {
-        cprintf("Segmentation Fault\n");
-        kill(p->pid);
-      }
+    if (r < 0 && (tf->cs&3) == 0) {
+      // The kernel should have checked with prefault() first.
+      cprintf("pagefault: pid %d va 0x%x eip 0x%x\n", myproc()->pid, rcr2(), tf->eip);
+      panic("kernel page fault");
+    }
+    if (r == -1) {
+      cprintf("Segmentation Fault\n");
+      kill(myproc()->pid);
+    } else if (r < 0) {
+      kill(myproc()->pid);
     }
     break;
   }
@@ -206,11 +375,19 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-  // Force process to give up CPU on clock tick.
+  // Charge the clock tick to the process; it gives up the CPU
+  // when its time slice is over (see schedtick), or sooner to
+  // a process woken with a better claim to it (see wakeup1).
   // If interrupts were on while locks held, would need to check nlock.
   if(myproc() && myproc()->state == RUNNING &&
-     tf->trapno == T_IRQ0+IRQ_TIMER)
-    yield();
+     (tick || myproc()->resched)){
+    myproc()->inuser = (tf->cs&3) == DPL_USER;
+    if(tick)
+      schedtick();
+    else
+      yield();
+    myproc()->inuser = 0;
+  }
 
   // Check if the process has been killed since we yielded
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
@@ -34,5 +34,6 @@
 #define IRQ_COM1         4
 #define IRQ_IDE         14
 #define IRQ_ERROR       19
+#define IRQ_RESCHED     20  // IPI: an idle CPU has work to steal
 #define IRQ_SPURIOUS    31
 
@@ -1,6 +1,16 @@
 #include "wmap.h"
 struct stat;
 struct rtcdate;
+struct swapstat;
+struct ksmstat;
+struct memstat;
+struct pagemapent;
+struct faulthist;
+struct spawnfa;
+struct schedstat;
+struct timespec;
+struct cpustat;
+struct lockstat;
 
 // system calls
 int fork(void);
@@ -28,6 +38,24 @@ uint wmap(uint addr, int length, int flags, int fd);
 int wunmap(uint addr);
 int getwmapinfo(struct wmapinfo *wminfo);
 uint va2pa(uint va);
+int getswapstat(struct swapstat *st);
+int getksmstat(struct ksmstat *st);
+int wfault(struct wfaultinfo *info);
+int wfill(int pid, uint addr, char *src);
+int wfhandler(uint addr, int pid);
+int wprotect(uint addr, int length, int prot);
+int getmemstat(int pid, struct memstat *st);
+int pagemap(uint va, int n, struct pagemapent *ents);
+int getfaulthist(int cpu, struct faulthist *h);
+int spawn(char *path, char **argv, struct spawnfa *fa);
+int setpriority(int pid, int level);
+int getschedstats(int pid, struct schedstat *st);
+int setaffinity(int pid, uint mask);
+int getaffinity(int pid);
+int clock_gettime(int clock, struct timespec *ts);
+int nanosleep(const struct timespec *req);
+int getcpustat(int cpu, struct cpustat *st);
+int lockstat(int op, struct lockstat *st, int n);
 
 
 // ulib.c
@@ -5,28 +5,67 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "spinlock.h"
 #include "elf.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
 
+// Page tables shared by fork (see copyuvm). A page-table page's
+// ref_count is the number of page directories pointing at it;
+// the lock keeps sharing and unsharing from racing, since each
+// side's decision depends on how many others are left.
+struct {
+  struct spinlock lock;
+} ptshare;
+
+// Pages freed together by freevm(); see kfreen().
+#define KBATCH 64
+struct kbatch {
+  char *page[KBATCH];
+  int n;
+};
+
+// Address spaces of reaped processes, waiting for the reaper
+// thread to tear them down so that wait() need not.
+struct {
+  struct spinlock lock;
+  pde_t *q[NPROC];
+  int head;
+  int n;
+  int busy;           // Reaper is freeing one
+  struct proc *proc;  // The reaper
+} reap;
+
 // Set up CPU's kernel segment descriptors.
 // Run once on entry on each CPU.
 void
 seginit(void)
 {
   struct cpu *c;
+  int apicid;
+
+  // Find this CPU by its APIC ID, which need not be contiguous.
+  // This is the only place that has to: the per-CPU segment
+  // set up below lets mycpu() go straight to it.
+  apicid = lapicid();
+  for(c = cpus; c < &cpus[ncpu] && c->apicid != apicid; c++)
+    ;
+  if(c == &cpus[ncpu])
+    panic("seginit: unknown apicid");
 
   // Map "logical" addresses to virtual addresses using identity map.
   // Cannot share a CODE descriptor for both kernel and user
   // because it would have to have DPL_USR, but the CPU forbids
   // an interrupt from CPL=0 to DPL=3.
-  c = &cpus[cpuid()];
   c->gdt[SEG_KCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, 0);
   c->gdt[SEG_KDATA] = SEG(STA_W, 0, 0xffffffff, 0);
   c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
   c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
+  c->gdt[SEG_KCPU] = SEG(STA_W, c, sizeof(*c) - 1, 0);
   lgdt(c->gdt, sizeof(c->gdt));
+  c->self = c;
+  loadgs(SEG_KCPU << 3);
 }
 
 // Return the address of the PTE in page table pgdir
@@ -40,6 +79,9 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
 
   pde = &pgdir[PDX(va)];
   if(*pde & PTE_P){
+    // About to add a mapping: the page table must be our own.
+    if(alloc && ptshared(pgdir, (uint)va) && unsharept(pgdir, (uint)va) < 0)
+      return 0;
     pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
   } else {
     if(!alloc || (pgtab = (pte_t*)kalloc()) == 0)
@@ -151,6 +193,7 @@ setupkvm(void)
 void
 kvmalloc(void)
 {
+  initlock(&ptshare.lock, "ptshare");
   kpgdir = setupkvm();
   switchkvm();
 }
@@ -255,7 +298,8 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
       return 0;
     }
     memset(mem, 0, PGSIZE);
-    if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
+    // PTE_A so that reclaim() gives the new page a second chance.
+    if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U|PTE_A) < 0){
       cprintf("allocuvm out of memory (2)\n");
       deallocuvm(pgdir, newsz, oldsz);
       kfree(mem);
@@ -265,12 +309,27 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   return newsz;
 }
 
-// Deallocate user pages to bring the process size from oldsz to
-// newsz.  oldsz and newsz need not be page-aligned, nor does newsz
-// need to be less than oldsz.  oldsz can be larger than the actual
-// process size.  Returns the new process size.
-int
-deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
+// Free v now, or add it to b if there is one.
+static void
+batchfree(struct kbatch *b, char *v)
+{
+  if(b == 0){
+    kfree(v);
+    return;
+  }
+  b->page[b->n++] = v;
+  if(b->n == KBATCH){
+    kfreen(b->page, b->n);
+    b->n = 0;
+  }
+}
+
+// Unmap user pages as deallocuvm() does, freeing them
+// through b if not 0. Fails, returning 0, only if there is no
+// memory to copy a shared page table that is partly unmapped;
+// whole tables, which is all freevm() unmaps, never need one.
+static int
+unmapuvm(pde_t *pgdir, uint oldsz, uint newsz, struct kbatch *b)
 {
   pte_t *pte;
   uint a, pa;
@@ -280,6 +339,18 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 
   a = PGROUNDUP(newsz);
   for(; a  < oldsz; a += PGSIZE){
+    if(ptshared(pgdir, a)){
+      if(a % PTSIZE == 0 && a + PTSIZE <= oldsz){
+        // Drop a whole shared page table; the pages in it
+        // belong to the others. If pgdir held the last
+        // reference, the table is its own again to empty.
+        if(droppt(pgdir, a)){
+          a += PTSIZE - PGSIZE;
+          continue;
+        }
+      } else if(unsharept(pgdir, a) < 0)
+        return 0;
+    }
     pte = walkpgdir(pgdir, (char*)a, 0);
     if(!pte)
       a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
@@ -287,31 +358,109 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
       pa = PTE_ADDR(*pte);
       if(pa == 0)
         panic("kfree");
-      char *v = P2V(pa);
-      kfree(v);
+      batchfree(b, P2V(pa));
+      *pte = 0;
+    } else if(*pte & PTE_SWAP){
+      swapfree(*pte);
       *pte = 0;
     }
   }
   return newsz;
 }
 
+// Deallocate user pages to bring the process size from oldsz to
+// newsz.  oldsz and newsz need not be page-aligned, nor does newsz
+// need to be less than oldsz.  oldsz can be larger than the actual
+// process size.  Returns the new process size.
+int
+deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
+{
+  return unmapuvm(pgdir, oldsz, newsz, 0);
+}
+
 // Free a page table and all the physical memory pages
 // in the user part.
 void
 freevm(pde_t *pgdir)
 {
+  struct kbatch b;
   uint i;
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
-  deallocuvm(pgdir, KERNBASE, 0);
+  b.n = 0;
+  unmapuvm(pgdir, KERNBASE, 0, &b);
   for(i = 0; i < NPDENTRIES; i++){
-    if(pgdir[i] & PTE_P){
-      char * v = P2V(PTE_ADDR(pgdir[i]));
-      kfree(v);
+    if(pgdir[i] & PTE_P)
+      batchfree(&b, P2V(PTE_ADDR(pgdir[i])));
+  }
+  batchfree(&b, (char*)pgdir);
+  kfreen(b.page, b.n);
+}
+
+// Hand pgdir to the reaper thread to free. Falls back
+// to freeing it here if the reaper is too far behind.
+void
+freevmlater(pde_t *pgdir)
+{
+  acquire(&reap.lock);
+  if(reap.n < NELEM(reap.q)){
+    reap.q[(reap.head + reap.n++) % NELEM(reap.q)] = pgdir;
+    wakeup(&reap);
+    release(&reap.lock);
+    return;
+  }
+  release(&reap.lock);
+  freevm(pgdir);
+}
+
+static void
+reaper(void *arg)
+{
+  pde_t *pgdir;
+
+  acquire(&reap.lock);
+  for(;;){
+    while(reap.n == 0)
+      sleep(&reap, &reap.lock);
+    pgdir = reap.q[reap.head];
+    reap.head = (reap.head + 1) % NELEM(reap.q);
+    reap.n--;
+    reap.busy = 1;
+    release(&reap.lock);
+    freevm(pgdir);
+    acquire(&reap.lock);
+    reap.busy = 0;
+    if(reap.n == 0)
+      wakeup(&reap.busy);
+  }
+}
+
+// Wait for the reaper to free what it has been given, for kalloc()
+// to try before reclaiming. Returns 0 if it had nothing.
+int
+reapwait(void)
+{
+  int waited = 0;
+
+  acquire(&reap.lock);
+  if(myproc() != reap.proc){
+    while(reap.n > 0 || reap.busy){
+      sleep(&reap.busy, &reap.lock);
+      waited = 1;
     }
   }
-  kfree((char*)pgdir);
+  release(&reap.lock);
+  return waited;
+}
+
+void
+reapinit(void)
+{
+  initlock(&reap.lock, "reap");
+  // kalloc() may wait for the reaper, so it must not be
+  // starved by the processes doing the waiting.
+  reap.proc = kthread_create("reaper", reaper, 0, PRIO_KERN);
 }
 
 // Clear PTE_U on a page. Used to create an inaccessible
@@ -327,50 +476,112 @@ clearpteu(pde_t *pgdir, char *uva)
   *pte &= ~PTE_U;
 }
 
+// Given a parent process's page table, create a copy
+// of it for a child. The page tables for [0, sz) are not copied
+// but shared: both page directories point at them read-only, so
+// that the first write by either side through one of them faults,
+// and unsharept() gives the writer a copy of just that table.
 pde_t*
 copyuvm(pde_t *pgdir, uint sz)
 {
   pde_t *d;
-  pte_t *pte;
-  uint pa, i, flags;
-  // char *mem;
+  uint a;
 
   if((d = setupkvm()) == 0)
     return 0;
-  for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
-    if(!(*pte & PTE_P))
-      panic("copyuvm: page not present");
-    pa = PTE_ADDR(*pte);
-    // cprintf("before pte write %d\n", *pte & PTE_W);
-    // cprintf("before pte COW %d\n", *pte & PTE_COW);
-
-    if(*pte & PTE_W) {
-      *pte &= ~PTE_W;
-      *pte |= PTE_COW;
-    } 
-
-    // cprintf("after pte write %d\n", *pte & PTE_W);
-    // cprintf("after pte COW %d\n", *pte & PTE_COW);
-    flags = PTE_FLAGS(*pte);
-    inc_ref_count(pa);
-  
-    // if((mem = kalloc()) == 0)
-    //   goto bad;
-    // memmove(mem, (char*)P2V(pa), PGSIZE);
-    if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0) {
-      // kfree(mem);
-      goto bad;
-    }
-     lcr3(V2P(pgdir));
+  acquire(&ptshare.lock);
+  for(a = 0; a < sz; a += PTSIZE){
+    if(!(pgdir[PDX(a)] & PTE_P))
+      continue;
+    pgdir[PDX(a)] &= ~PTE_W;
+    d[PDX(a)] = pgdir[PDX(a)];
+    inc_ref_count(PTE_ADDR(pgdir[PDX(a)]));
   }
+  release(&ptshare.lock);
+  lcr3(V2P(pgdir));
   return d;
+}
+
+// Is the page table covering va shared with another page
+// directory since fork? Writes through it then fault.
+int
+ptshared(pde_t *pgdir, uint va)
+{
+  return (pgdir[PDX(va)] & (PTE_P|PTE_W)) == PTE_P;
+}
+
+// Give pgdir its own copy of the shared page table covering va.
+// Every page the table maps is then mapped by two tables, so the
+// writable ones become COW in both. If the others have already
+// made their own copies, the table is simply made writable again.
+// Returns 0, or -1 if there is no memory for the copy.
+int
+unsharept(pde_t *pgdir, uint va)
+{
+  pde_t *pde;
+  pte_t *pt, *npt;
+  char *mem;
+  int i;
 
-bad:
-  freevm(d);
+  // Allocate the copy only if the others still hold the
+  // table; kalloc() may sleep, so not with the lock held.
+  mem = 0;
+  for(;;){
+    acquire(&ptshare.lock);
+    pde = &pgdir[PDX(va)];
+    pt = (pte_t*)P2V(PTE_ADDR(*pde));
+    if(!ptshared(pgdir, va) || get_ref_count(V2P(pt)) == 1 || mem)
+      break;
+    release(&ptshare.lock);
+    if((mem = kalloc()) == 0)
+      return -1;
+  }
+  if(ptshared(pgdir, va) && get_ref_count(V2P(pt)) == 1)
+    *pde |= PTE_W;
+  else if(ptshared(pgdir, va)){
+    npt = (pte_t*)mem;
+    mem = 0;
+    for(i = 0; i < NPTENTRIES; i++){
+      if(pt[i] & PTE_P){
+        if(pt[i] & PTE_W)
+          pt[i] = (pt[i] & ~PTE_W) | PTE_COW;
+        inc_ref_count(PTE_ADDR(pt[i]));
+      } else if(pt[i] & PTE_SWAP)
+        swapdup(pt[i]);
+      npt[i] = pt[i];
+    }
+    *pde = V2P(npt) | PTE_P | PTE_W | PTE_U;
+    kfree((char*)pt);  // drop our reference
+  }
+  release(&ptshare.lock);
+  if(mem)
+    kfree(mem);
+  if(myproc() && myproc()->pgdir == pgdir)
+    lcr3(V2P(pgdir));
   return 0;
-}//PAGEBREAK!
+}
+
+// Drop pgdir's reference to the shared page table covering va.
+// Returns 0 without doing so if pgdir holds the last reference;
+// the table is then pgdir's own again.
+int
+droppt(pde_t *pgdir, uint va)
+{
+  pde_t *pde = &pgdir[PDX(va)];
+  int dropped;
+
+  acquire(&ptshare.lock);
+  dropped = get_ref_count(PTE_ADDR(*pde)) > 1;
+  if(dropped){
+    kfree(P2V(PTE_ADDR(*pde)));
+    *pde = 0;
+  } else
+    *pde |= PTE_W;
+  release(&ptshare.lock);
+  return dropped;
+}
+
+//PAGEBREAK!
 // Map user virtual address to kernel address.
 char*
 uva2ka(pde_t *pgdir, char *uva)
@@ -378,7 +589,7 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
@@ -394,6 +605,11 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
   char *buf, *pa0;
   uint n, va0;
 
+  // Into the current process: write through its mappings, and
+  // let the page fault handler fault in pages and break COW.
+  if(myproc() && pgdir == myproc()->pgdir)
+    return copy_to_user(va, p, len);
+
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
@@ -411,6 +627,118 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
   return 0;
 }
 
+// Number of pages present in pgdir in [start, end).
+int
+resident(pde_t *pgdir, uint start, uint end)
+{
+  pte_t *pte;
+  uint a;
+  int n;
+
+  n = 0;
+  for(a = PGROUNDDOWN(start); a < end; a += PGSIZE){
+    pte = walkpgdir(pgdir, (char*)a, 0);
+    if(!pte)
+      a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
+    else if(*pte & PTE_P)
+      n++;
+  }
+  return n;
+}
+
+// Number of page-table pages mapping user memory in pgdir.
+int
+ptpages(pde_t *pgdir)
+{
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < PDX(KERNBASE); i++)
+    if(pgdir[i] & PTE_P)
+      n++;
+  return n;
+}
+
+// Is [va, va+n) user memory, below KERNBASE?
+static int
+useraddr(uint va, uint n)
+{
+  return va + n >= va && va + n <= KERNBASE;
+}
+
+// Copy len bytes from p to user address va in the current address
+// space. The range is checked and faulted in first (see prefault):
+// the kernel's own accesses do not fault on a page that is present
+// but closed to the user, such as a PROT_NONE wmap page. Returns -1
+// if part of the range is not mapped writable, 0 otherwise.
+int
+copy_to_user(uint va, void *p, uint len)
+{
+  if(prefault(myproc(), va, len, 1) < 0)
+    return -1;
+  return usercopy((void*)va, p, len);
+}
+
+// Copy len bytes from user address va in the current address
+// space to p. Returns -1 if part of the range is not mapped
+// readable.
+int
+copy_from_user(void *p, uint va, uint len)
+{
+  if(prefault(myproc(), va, len, 0) < 0)
+    return -1;
+  return usercopy(p, (void*)va, len);
+}
+
+// Does the current process let the user at every page of
+// [va, va+len) that is present? Pages that are not are left
+// for the copy to fault on.
+static int
+userpages(uint va, uint len)
+{
+  pte_t *pte;
+  uint a;
+
+  if(!useraddr(va, len))
+    return 0;
+  for(a = PGROUNDDOWN(va); a < va + len; a += PGSIZE){
+    pte = walkpgdir(myproc()->pgdir, (char*)a, 0);
+    if(pte && (*pte & PTE_P) && !(*pte & PTE_U))
+      return 0;
+  }
+  return 1;
+}
+
+// Like copy_to_user and copy_from_user, but a page that is not
+// ready fails the copy instead of being faulted in (see trap), so
+// the caller may hold locks the fault handler could need: an inode
+// lock, when va is a map of that same file.
+int
+copy_to_user_nofault(uint va, void *p, uint len)
+{
+  int r;
+
+  if(!userpages(va, len))
+    return -1;
+  pushcli();
+  r = usercopy((void*)va, p, len);
+  popcli();
+  return r;
+}
+
+int
+copy_from_user_nofault(void *p, uint va, uint len)
+{
+  int r;
+
+  if(!userpages(va, len))
+    return -1;
+  pushcli();
+  r = usercopy(p, (void*)va, len);
+  popcli();
+  return r;
+}
+
 //PAGEBREAK!
 // Blank page.
 //PAGEBREAK!
@@ -4,6 +4,13 @@
 #define MAP_SHARED 0x0002
 #define MAP_ANONYMOUS 0x0004
 #define MAP_FIXED 0x0008
+#define MAP_MERGEABLE 0x0010  // Let ksmd merge identical anonymous pages
+#define MAP_USERFAULT 0x0020  // Faults wait for a handler to wfill() the page
+
+// Protection for wprotect
+#define PROT_NONE 0x0
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
 
 // When any system call fails, returns -1
 #define FAILED -1
@@ -17,4 +24,23 @@ struct wmapinfo {
     int length[MAX_WMMAP_INFO];         // Size of mapping
     int n_loaded_pages[MAX_WMMAP_INFO]; // Number of pages physically loaded into memory
 };
+
+// for `pagemap`
+#define PM_PRESENT  0x01  // Page is in memory
+#define PM_WRITE    0x02  // Writable
+#define PM_ACCESSED 0x04  // PTE_A set
+#define PM_DIRTY    0x08  // PTE_D set
+#define PM_COW      0x10  // Shared copy-on-write
+#define PM_SWAP     0x20  // Swapped out; pfn is the swap slot
+struct pagemapent {
+    uint pfn;   // Physical frame number (pa >> 12)
+    uint flags; // PM_ bits, 0 if nothing is mapped
+    uint refs;  // References to the frame
+};
+
+// for `wfault`
+struct wfaultinfo {
+    int pid;    // Process waiting on the fault
+    uint addr;  // Page-aligned faulting address
+};
 #endif
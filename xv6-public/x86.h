@@ -117,6 +117,14 @@ sti(void)
   asm volatile("sti");
 }
 
+// Enable interrupts and wait for one. sti takes effect only
+// after the next instruction, so none can slip in before hlt.
+static inline void
+stihlt(void)
+{
+  asm volatile("sti; hlt" : : : "memory");
+}
+
 static inline uint
 xchg(volatile uint *addr, uint newval)
 {
@@ -130,6 +138,23 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+// Atomically add v to *addr, returning the old value.
+static inline uint
+xadd(volatile uint *addr, uint v)
+{
+  asm volatile("lock; xaddl %0, %1" :
+               "+r" (v), "+m" (*addr) : :
+               "memory", "cc");
+  return v;
+}
+
+// Tell the CPU it is in a spin-wait loop.
+static inline void
+pause(void)
+{
+  asm volatile("pause");
+}
+
 static inline uint
 rcr2(void)
 {
@@ -144,6 +169,15 @@ lcr3(uint val)
   asm volatile("movl %0,%%cr3" : : "r" (val));
 }
 
+// Read the time-stamp counter.
+static inline uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
 //PAGEBREAK: 36
 // Layout of the trap frame built on the stack by the
 // hardware and by trapasm.S, and passed to trap().
@@ -0,0 +1,222 @@
+// Compressed swap pool.
+//
+// Before writing a page to the swap area, swapwrite() offers it to
+// the pool: the page is compressed with a small LZ77 codec and, if it
+// shrinks enough, kept in memory instead of going to the disk. A
+// fault on the page then costs a decompression rather than eight PIO
+// disk reads.
+//
+// The pool is a set of whole pages, at most ZSWAPPAGES of them, into
+// which compressed pages are packed end to end. A pool page is freed
+// once every compressed page in it has been dropped; the space of a
+// dropped page is not reused before that. Since reclaim() runs when
+// kalloc() has nothing left, a new pool page is not allocated but
+// taken over from the page being compressed, which is then stored
+// in its own frame.
+//
+// Compressed format: a sequence of tokens. A byte t < 0x80 is
+// followed by t+1 literal bytes. A byte t >= 0x80 is followed by a
+// two-byte little-endian offset o, and copies (t & 0x7f) + 3 bytes
+// starting o+1 bytes back in the output.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "swap.h"
+
+#define ZMAXLEN   (PGSIZE*3/4)  // store only pages that compress at least this well
+#define MINMATCH  3
+#define MAXMATCH  (0x7f + MINMATCH)
+#define MAXLIT    0x80
+#define HLOG      12
+#define HASH(p)   ((((p)[0] | (p)[1] << 8 | (p)[2] << 16) * 2654435761U) >> (32 - HLOG))
+
+struct zpage {
+  char *mem;   // 0 if unused
+  uint used;   // bytes handed out from the start of mem
+  uint nobj;   // compressed pages still in mem
+};
+
+struct {
+  struct spinlock lock;
+  struct zpage page[ZSWAPPAGES];
+  int npage;
+  uint nstored;           // compressed pages in the pool
+  uint nbytes;            // their total compressed size
+  ushort htab[1 << HLOG]; // for lzcompress(): position+1 of last match candidate
+  uchar buf[ZMAXLEN];     // compressor output
+} zswap;
+
+void
+zswapinit(void)
+{
+  initlock(&zswap.lock, "zswap");
+}
+
+// Compress the page at in into out. Returns the compressed
+// length, or -1 if it would be longer than max.
+static int
+lzcompress(uchar *in, uchar *out, int max)
+{
+  int ip, op, ref, len, off, lit, nlit;
+  uint h;
+
+  memset(zswap.htab, 0, sizeof(zswap.htab));
+  ip = op = 0;
+  lit = -1;
+  nlit = 0;
+  while(ip < PGSIZE){
+    if(ip + MINMATCH <= PGSIZE){
+      h = HASH(in + ip);
+      ref = zswap.htab[h] - 1;
+      zswap.htab[h] = ip + 1;
+      if(ref >= 0 && in[ref] == in[ip] && in[ref+1] == in[ip+1] &&
+         in[ref+2] == in[ip+2]){
+        len = MINMATCH;
+        while(len < MAXMATCH && ip + len < PGSIZE && in[ref+len] == in[ip+len])
+          len++;
+        if(op + 3 > max)
+          return -1;
+        off = ip - ref - 1;
+        out[op++] = 0x80 | (len - MINMATCH);
+        out[op++] = off & 0xff;
+        out[op++] = off >> 8;
+        ip += len;
+        lit = -1;
+        continue;
+      }
+    }
+    if(lit < 0){
+      if(op + 2 > max)
+        return -1;
+      lit = op++;
+      nlit = 0;
+    } else if(op + 1 > max)
+      return -1;
+    out[op++] = in[ip++];
+    out[lit] = nlit++;
+    if(nlit == MAXLIT)
+      lit = -1;
+  }
+  return op;
+}
+
+// Expand n bytes at in into a page at out.
+static int
+lzdecompress(uchar *in, int n, uchar *out)
+{
+  int ip, op, len, ref;
+  uchar t;
+
+  ip = op = 0;
+  while(ip < n){
+    t = in[ip++];
+    if(t < 0x80){
+      len = t + 1;
+      if(ip + len > n || op + len > PGSIZE)
+        return -1;
+      memmove(out + op, in + ip, len);
+      ip += len;
+      op += len;
+    } else {
+      len = (t & 0x7f) + MINMATCH;
+      if(ip + 2 > n)
+        return -1;
+      ref = op - (in[ip] | in[ip+1] << 8) - 1;
+      ip += 2;
+      if(ref < 0 || op + len > PGSIZE)
+        return -1;
+      while(len-- > 0)
+        out[op++] = out[ref++];
+    }
+  }
+  return op == PGSIZE ? 0 : -1;
+}
+
+// Compress page into the pool. If the pool needs another page and
+// cangive is set, page itself becomes a pool page and *gave is set.
+// Returns the compressed length and sets *handle, or returns 0 if
+// the page does not compress well or the pool is full.
+int
+zput(char *page, int cangive, int *gave, uint *handle)
+{
+  struct zpage *z;
+  int n;
+
+  *gave = 0;
+  acquire(&zswap.lock);
+  if((n = lzcompress((uchar*)page, zswap.buf, ZMAXLEN)) < 0)
+    goto fail;
+  for(z = zswap.page; z < &zswap.page[ZSWAPPAGES]; z++)
+    if(z->mem && PGSIZE - z->used >= n)
+      break;
+  if(z == &zswap.page[ZSWAPPAGES]){
+    if(!cangive)
+      goto fail;
+    for(z = zswap.page; z < &zswap.page[ZSWAPPAGES]; z++)
+      if(z->mem == 0)
+        break;
+    if(z == &zswap.page[ZSWAPPAGES])
+      goto fail;
+    z->mem = page;
+    z->used = 0;
+    z->nobj = 0;
+    zswap.npage++;
+    *gave = 1;
+  }
+  memmove(z->mem + z->used, zswap.buf, n);
+  *handle = (z - zswap.page) << PTXSHIFT | z->used;
+  z->used += n;
+  z->nobj++;
+  zswap.nstored++;
+  zswap.nbytes += n;
+  release(&zswap.lock);
+  return n;
+
+fail:
+  release(&zswap.lock);
+  return 0;
+}
+
+// Decompress the n bytes at handle into page.
+void
+zget(uint handle, int n, char *page)
+{
+  struct zpage *z = &zswap.page[handle >> PTXSHIFT];
+
+  acquire(&zswap.lock);
+  if(lzdecompress((uchar*)z->mem + (handle & 0xfff), n, (uchar*)page) < 0)
+    panic("zget");
+  release(&zswap.lock);
+}
+
+// Drop the n bytes at handle from the pool.
+void
+zdrop(uint handle, int n)
+{
+  struct zpage *z = &zswap.page[handle >> PTXSHIFT];
+
+  acquire(&zswap.lock);
+  zswap.nstored--;
+  zswap.nbytes -= n;
+  if(--z->nobj == 0){
+    kfree(z->mem);
+    z->mem = 0;
+    zswap.npage--;
+  }
+  release(&zswap.lock);
+}
+
+void
+zstat(struct swapstat *st)
+{
+  acquire(&zswap.lock);
+  st->zstored = zswap.nstored;
+  st->zbytes = zswap.nbytes;
+  st->zpages = zswap.npage;
+  st->zmaxpages = ZSWAPPAGES;
+  release(&zswap.lock);
+}